@@ -0,0 +1,665 @@
+// system headers first, grs.h defines a swap macro they would trip over
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "ninecalc.cpp"
+
+/*
+	Headless NineCalc: evaluates a document top to bottom with the editor's semantics
+	(variables, ':', prev and sum) and writes "line<TAB>result" for every line.
+	Lines without a result get nothing after the tab.
+
+	Lines are tokenized straight from the UTF-8 bytes: files are mapped, pipes are read in
+	chunks, and memory use depends on the longest line rather than on the whole input.
+
+	With more than one thread, a window of lines is cut into chunks that the workers take
+	one at a time. They compile every line and evaluate right away the ones that touch no
+	variables (prev and sum included), which is most of them, adding up what those give
+	sum as they go. The main thread then goes through the window in order, running the
+	rest and keeping prev and sum, and the workers format the chunks. The output is the
+	same as with one thread.
+
+	usage: ninecalc_batch [-j threads] [file]    reads stdin when no file is given,
+	                                            one thread per core by default
+*/
+
+#define BATCH_RESULT_LENGTH 64
+#define BATCH_CHUNK_SIZE    kibibytes(64)
+#define BATCH_WINDOW_CHUNKS 256
+#define BATCH_MAX_THREADS   64
+
+struct Batch_Output
+{
+	int file;
+	u8 *buffer;
+	u64 size;
+	u64 used;
+};
+
+internal Memory_Arena
+batch_allocate_memory(u64 size)
+{
+	// only address space, pages are committed as they are touched
+	Memory_Arena memory = {};
+	void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (data != MAP_FAILED)
+	{
+		memory.data = (u8*)data;
+		memory.size = size;
+	}
+	return(memory);
+}
+
+internal bool32
+batch_map_file(int file, u8 **data, u64 *size)
+{
+	// only regular files; the pages come and go as the kernel likes, nothing is copied
+	struct stat status;
+	if (fstat(file, &status) || !S_ISREG(status.st_mode))
+		return(false);
+
+	*data = 0;
+	*size = status.st_size;
+	if (*size)
+	{
+		void *mapped = mmap(0, *size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapped == MAP_FAILED)
+			return(false);
+		madvise(mapped, *size, MADV_SEQUENTIAL);
+		*data = (u8*)mapped;
+	}
+	return(true);
+}
+
+internal void
+batch_flush(Batch_Output *output)
+{
+	u64 written = 0;
+	while (written < output->used)
+	{
+		ssize_t result = write(output->file, output->buffer + written, output->used - written);
+		if (result <= 0)
+			break;
+		written += result;
+	}
+	output->used = 0;
+}
+
+internal inline void
+batch_write(Batch_Output *output, u8 *bytes, u64 count)
+{
+	if (output->used + count > output->size)
+	{
+		batch_flush(output);
+		if (count > output->size)
+		{
+			// too long to be worth buffering
+			Batch_Output direct = *output;
+			direct.buffer = bytes;
+			direct.used   = count;
+			batch_flush(&direct);
+			return;
+		}
+	}
+	memcpy(output->buffer + output->used, bytes, count);
+	output->used += count;
+}
+
+internal inline void
+batch_write_byte(Batch_Output *output, u8 byte)
+{
+	if (output->used == output->size)
+		batch_flush(output);
+	output->buffer[output->used++] = byte;
+}
+
+struct Batch_Total
+{
+	// what a run of lines that use no variables does to prev and sum
+	u64 count;       // valid results
+	Result last;
+	f64 sum;         // from -0, which adds like nothing at all
+	f64 magnitude;   // of the results, a bound on every partial sum
+	s32 lowest_bit;  // the smallest exponent of a set bit in any of them
+	bool32 finite;
+};
+
+struct Batch_Program
+{
+	Program program;
+	UTF8_String *names;  // of the slots, a worker's atoms mean nothing to the main thread
+	Batch_Total before;  // the lines since the previous program in the chunk
+};
+
+struct Batch_Line
+{
+	u8 *text;
+	u64 length; // without the line break
+	Result result;
+	Batch_Program *deferred; // uses variables, so it runs when the lines above it have
+};
+
+struct Batch_Chunk
+{
+	u8 *text; // whole lines
+	u8 *end;
+	Batch_Line *lines;
+	u64 line_count;
+	u64 *deferred; // which lines
+	u64 deferred_count;
+	Batch_Total tail;
+	u8 *output;
+	u64 output_size;
+};
+
+struct Batch_Pool;
+
+struct Batch_Worker
+{
+	pthread_t thread;
+	bool32 started;
+	Batch_Pool *pool;
+	Memory_Arena window; // line records and output, for the current window
+	Memory_Arena temp;   // one line at a time
+	Memory_Arena memory; // its own atoms, which mean nothing outside the worker
+	Atom_Table atoms;
+	Context context;
+};
+
+typedef void Batch_Work(Batch_Worker *worker, Batch_Chunk *chunk);
+
+struct Batch_Pool
+{
+	Batch_Worker *workers;
+	u32 worker_count;
+	Batch_Chunk *chunks;
+	u64 chunk_count;
+	u64 next_chunk; // taken with an atomic add, so whoever is free takes the next one
+	Batch_Work *work;
+};
+
+struct Batch_State
+{
+	Memory_Arena temp; // one line at a time
+	Context context;
+	Batch_Output output;
+	Batch_Pool *pool;  // none with one thread
+};
+
+internal u64
+batch_line_length(u8 *line, u8 *end)
+{
+	u64 length = end - line;
+	if (length && line[length - 1] == '\r')
+		--length;
+	return(length);
+}
+
+internal void
+batch_update_implicit_variables(Batch_State *state, Result result)
+{
+	// as in update_implicit_variables: a line may assign them, its own result comes after that
+	if (result.valid)
+	{
+		add_or_update_variable(&state->context, Atom_Prev, result.value);
+		add_or_update_variable(&state->context, Atom_Sum, state->context[Atom_Sum].value + result.value);
+	}
+}
+
+internal void
+batch_store_implicit_variables(Batch_State *state, Result prev, Result sum)
+{
+	if (prev.valid)
+		add_or_update_variable(&state->context, Atom_Prev, prev.value);
+	if (sum.valid)
+		add_or_update_variable(&state->context, Atom_Sum, sum.value);
+}
+
+internal void
+batch_put_line(Batch_Output *output, u8 *line, u64 length, Result result)
+{
+	batch_write(output, line, length);
+	batch_write_byte(output, '\t');
+	if (result.valid)
+	{
+		u32 result_text[BATCH_RESULT_LENGTH];
+		u64 result_length = format_f64(result_text, array_count(result_text), result.value);
+		for (u64 i = 0; i < result_length; ++i)
+			batch_write_byte(output, (u8)result_text[i]);
+	}
+	batch_write_byte(output, '\n');
+}
+
+internal Result
+batch_evaluate_in_order(Batch_State *state, u8 *line, u64 length)
+{
+	state->temp.used = 0;
+	Result result = evaluate_expression(&state->temp, UTF8_String{ line, length }, &state->context);
+	batch_update_implicit_variables(state, result);
+	return(result);
+}
+
+internal Result
+batch_run_deferred(Batch_State *state, Batch_Program *deferred)
+{
+	Program *program = &deferred->program;
+	for (u32 i = 0; i < program->slot_count; ++i)
+		program->slots[i] = intern(state->context.atoms, deferred->names[i]);
+
+	state->temp.used = 0;
+	Result result = run_program(&state->temp, program, &state->context);
+	batch_update_implicit_variables(state, result);
+	return(result);
+}
+
+internal void
+batch_evaluate_line(Batch_State *state, u8 *line, u8 *end)
+{
+	u64 length = batch_line_length(line, end);
+	Result result = batch_evaluate_in_order(state, line, length);
+	batch_put_line(&state->output, line, length, result);
+}
+
+internal s32
+lowest_set_bit(f64 value)
+{
+	// value, not 0 and finite, is an odd multiple of 2 to this
+#if LDBL_MANT_DIG == 64
+	// x87 extended: the whole mantissa, leading bit included, is the low 8 bytes
+	u64 mantissa;
+	u16 exponent;
+	memcpy(&mantissa, &value, sizeof(mantissa));
+	memcpy(&exponent, (u8*)&value + sizeof(mantissa), sizeof(exponent));
+	exponent &= 0x7FFF;
+	s32 lowest = (exponent? exponent : 1) - 16383 - 63;
+	return(lowest + __builtin_ctzll(mantissa));
+#else
+	int exponent;
+	f64 mantissa = std::frexp(value, &exponent);
+	u64 bits = (u64)std::ldexp(std::fabs(mantissa), F64_MANTISSA_BITS + 1);
+	return(exponent - (F64_MANTISSA_BITS + 1) + __builtin_ctzll(bits));
+#endif
+}
+
+internal Batch_Total
+make_total()
+{
+	Batch_Total total = {};
+	total.sum = -(f64)0;
+	total.lowest_bit = 1 << 20; // above any exponent, so with no bits set it never limits
+	total.finite = true;
+	return(total);
+}
+
+internal void
+add_to_total(Batch_Total *total, Result result)
+{
+	if (result.valid)
+	{
+		++total->count;
+		total->last = result;
+		total->sum += result.value;
+		total->magnitude += std::fabs(result.value);
+		if (!std::isfinite(result.value))
+			total->finite = false;
+		else if (result.value != 0)
+			total->lowest_bit = (s32)minimum(total->lowest_bit, lowest_set_bit(result.value));
+	}
+}
+
+internal bool32
+add_total_exactly(Result *prev, Result *sum, Batch_Total *total)
+{
+	// Adding in another order only gives the same sum when no addition rounds. With every
+	// value a multiple of 2^lowest_bit, that holds while no partial sum can outgrow the mantissa.
+	if (!total->count)
+		return(true);
+
+	f64 start = sum->value; // 0 before the first valid result
+	if (!total->finite || !std::isfinite(start))
+		return(false);
+
+	s32 lowest = total->lowest_bit;
+	if (start != 0)
+		lowest = (s32)minimum(lowest, lowest_set_bit(start));
+	if (!(std::fabs(start) + total->magnitude < std::ldexp((f64)1, F64_MANTISSA_BITS + 1 + lowest)))
+		return(false);
+
+	*prev = total->last;
+	*sum  = { true, start + total->sum };
+	return(true);
+}
+
+internal Batch_Program *
+keep_program(Memory_Arena *arena, Program *program, Atom_Table *atoms)
+{
+	Batch_Program *kept = allocate_struct(arena, Batch_Program);
+	kept->program = *program;
+	kept->program.code      = allocate_array(arena, Instruction, program->code_count);
+	kept->program.constants = allocate_array(arena, f64, program->constant_count);
+	kept->program.slots     = allocate_array(arena, Atom, program->slot_count);
+	kept->names             = allocate_array(arena, UTF8_String, program->slot_count);
+	for (u32 i = 0; i < program->code_count; ++i)
+		kept->program.code[i] = program->code[i];
+	for (u32 i = 0; i < program->constant_count; ++i)
+		kept->program.constants[i] = program->constants[i];
+	for (u32 i = 0; i < program->slot_count; ++i)
+		kept->names[i] = atoms->names[program->slots[i]];
+	return(kept);
+}
+
+internal void
+batch_prepare_chunk(Batch_Worker *worker, Batch_Chunk *chunk)
+{
+	// lines that use no variables come out the same whenever they are evaluated,
+	// the others are compiled here and run in order on the main thread
+	chunk->line_count = 0;
+	for (u8 *text = chunk->text; text < chunk->end; ++chunk->line_count)
+		text = (u8*)memchr(text, '\n', chunk->end - text) + 1;
+	chunk->lines    = allocate_array(&worker->window, Batch_Line, chunk->line_count);
+	chunk->deferred = allocate_array(&worker->window, u64, chunk->line_count);
+	chunk->deferred_count = 0;
+
+	Batch_Total total = make_total();
+	u8 *text = chunk->text;
+	for (u64 i = 0; i < chunk->line_count; ++i)
+	{
+		u8 *newline = (u8*)memchr(text, '\n', chunk->end - text);
+		Batch_Line *line = chunk->lines + i;
+		line->text     = text;
+		line->length   = batch_line_length(text, newline);
+		line->result   = {};
+		line->deferred = 0;
+
+		worker->temp.used = 0;
+		Token_List tokens = tokenize_expression(&worker->temp, UTF8_String{ line->text, line->length }, &worker->atoms);
+		AST *tree = parse_tokens(&worker->temp, tokens);
+		Program program = compile_tree(&worker->temp, tree, tokens);
+		if (program.slot_count)
+		{
+			line->deferred = keep_program(&worker->window, &program, &worker->atoms);
+			line->deferred->before = total;
+			chunk->deferred[chunk->deferred_count++] = i;
+			total = make_total();
+		}
+		else
+		{
+			line->result = run_program(&worker->temp, &program, &worker->context);
+			add_to_total(&total, line->result);
+		}
+
+		text = newline + 1;
+	}
+	chunk->tail = total;
+}
+
+internal void
+batch_format_chunk(Batch_Worker *worker, Batch_Chunk *chunk)
+{
+	// room for every line with a tab, the longest result and a line break, so it never flushes
+	Batch_Output output = {};
+	output.file   = -1;
+	output.size   = (chunk->end - chunk->text) + chunk->line_count * (BATCH_RESULT_LENGTH + 2);
+	output.buffer = allocate_array(&worker->window, u8, output.size);
+	for (u64 i = 0; i < chunk->line_count; ++i)
+	{
+		Batch_Line *line = chunk->lines + i;
+		batch_put_line(&output, line->text, line->length, line->result);
+	}
+	chunk->output      = output.buffer;
+	chunk->output_size = output.used;
+}
+
+internal void *
+batch_work(void *parameter)
+{
+	Batch_Worker *worker = (Batch_Worker*)parameter;
+	Batch_Pool *pool = worker->pool;
+	for (;;)
+	{
+		u64 i = __atomic_fetch_add(&pool->next_chunk, 1, __ATOMIC_RELAXED);
+		if (i >= pool->chunk_count)
+			break;
+		pool->work(worker, pool->chunks + i);
+	}
+	return(0);
+}
+
+internal void
+batch_run(Batch_Pool *pool, Batch_Work *work)
+{
+	// the calling thread is worker 0; if a thread can't start, the others take its share
+	pool->work = work;
+	pool->next_chunk = 0;
+	for (u32 i = 1; i < pool->worker_count; ++i)
+		pool->workers[i].started = !pthread_create(&pool->workers[i].thread, 0, batch_work, pool->workers + i);
+	batch_work(pool->workers);
+	for (u32 i = 1; i < pool->worker_count; ++i)
+	{
+		if (pool->workers[i].started)
+			pthread_join(pool->workers[i].thread, 0);
+	}
+}
+
+internal u8 *
+batch_evaluate_lines_in_parallel(Batch_State *state, u8 *text, u8 *end)
+{
+	// returns where the last, unfinished line starts
+	Batch_Pool *pool = state->pool;
+	for (;;)
+	{
+		pool->chunk_count = 0;
+		while (text < end && pool->chunk_count < BATCH_WINDOW_CHUNKS)
+		{
+			u8 *cut = text + minimum(end - text, BATCH_CHUNK_SIZE) - 1;
+			u8 *newline = (u8*)memchr(cut, '\n', end - cut);
+			if (!newline)
+				newline = (u8*)memrchr(text, '\n', cut - text);
+			if (!newline)
+				break;
+
+			Batch_Chunk *chunk = pool->chunks + pool->chunk_count++;
+			*chunk = {};
+			chunk->text = text;
+			chunk->end  = newline + 1;
+			text = chunk->end;
+		}
+		if (!pool->chunk_count)
+			break;
+
+		for (u32 i = 0; i < pool->worker_count; ++i)
+			pool->workers[i].window.used = 0;
+		batch_run(pool, batch_prepare_chunk);
+
+		// prev and sum stay out of the context until a line can read them, this is the only
+		// part of the window that doesn't run in parallel
+		Result prev = state->context[Atom_Prev];
+		Result sum  = state->context[Atom_Sum];
+		for (u64 i = 0; i < pool->chunk_count; ++i)
+		{
+			Batch_Chunk *chunk = pool->chunks + i;
+			u64 run_start = 0;
+			for (u64 j = 0; j <= chunk->deferred_count; ++j)
+			{
+				u64 run_end = j < chunk->deferred_count? chunk->deferred[j] : chunk->line_count;
+				Batch_Line *deferred = chunk->lines + run_end;
+				Batch_Total *total = j < chunk->deferred_count? &deferred->deferred->before : &chunk->tail;
+
+				// the lines in between one at a time when their total might not add up the same
+				if (!add_total_exactly(&prev, &sum, total))
+				{
+					for (u64 k = run_start; k < run_end; ++k)
+					{
+						Result result = chunk->lines[k].result;
+						if (result.valid)
+						{
+							prev = result;
+							sum  = { true, sum.value + result.value };
+						}
+					}
+				}
+
+				if (j < chunk->deferred_count)
+				{
+					batch_store_implicit_variables(state, prev, sum);
+					deferred->result = batch_run_deferred(state, deferred->deferred);
+					prev = state->context[Atom_Prev];
+					sum  = state->context[Atom_Sum];
+				}
+				run_start = run_end + 1;
+			}
+		}
+		batch_store_implicit_variables(state, prev, sum);
+
+		batch_run(pool, batch_format_chunk);
+		for (u64 i = 0; i < pool->chunk_count; ++i)
+			batch_write(&state->output, pool->chunks[i].output, pool->chunks[i].output_size);
+	}
+	return(text);
+}
+
+internal u8 *
+batch_evaluate_lines(Batch_State *state, u8 *text, u8 *end)
+{
+	// returns where the last, unfinished line starts
+	if (state->pool)
+		return(batch_evaluate_lines_in_parallel(state, text, end));
+
+	while (text < end)
+	{
+		u8 *newline = (u8*)memchr(text, '\n', end - text);
+		if (!newline)
+			break;
+		batch_evaluate_line(state, text, newline);
+		text = newline + 1;
+	}
+	return(text);
+}
+
+internal bool32
+batch_evaluate_stream(Batch_State *state, int file, Memory_Arena *buffer)
+{
+	// the buffer only grows past its first chunk for a line longer than that
+	u64 chunk = mebibytes(4);
+	u64 filled = 0;
+	for (;;)
+	{
+		if (buffer->used < filled + chunk)
+			allocate_bytes(buffer, filled + chunk - buffer->used);
+
+		ssize_t bytes_read = read(file, buffer->data + filled, chunk);
+		if (bytes_read < 0)
+			return(false);
+		if (!bytes_read)
+			break;
+		filled += bytes_read;
+
+		u8 *rest = batch_evaluate_lines(state, buffer->data, buffer->data + filled);
+		filled = buffer->data + filled - rest;
+		memmove(buffer->data, rest, filled);
+	}
+	if (filled)
+		batch_evaluate_line(state, buffer->data, buffer->data + filled);
+	return(true);
+}
+
+int
+main(int argument_count, char **arguments)
+{
+	s64 thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+	char *input_name = 0;
+	for (int i = 1; i < argument_count; ++i)
+	{
+		if (!strcmp(arguments[i], "-j") && i + 1 < argument_count)
+			thread_count = atoi(arguments[++i]);
+		else if (!input_name)
+			input_name = arguments[i];
+		else
+		{
+			fprintf(stderr, "usage: ninecalc_batch [-j threads] [file]\n");
+			return(1);
+		}
+	}
+	thread_count = clamp(thread_count, 1, BATCH_MAX_THREADS);
+
+	int input_file = 0;
+	if (input_name)
+	{
+		input_file = open(input_name, O_RDONLY);
+		if (input_file < 0)
+		{
+			fprintf(stderr, "ninecalc_batch: can't open %s\n", input_name);
+			return(1);
+		}
+	}
+
+	Memory_Arena buffer = batch_allocate_memory(tebibytes(1)); // for input that can't be mapped
+	Memory_Arena memory = batch_allocate_memory(gibibytes(64)); // identifiers and variables, for the whole run
+	Batch_State state = {};
+	state.temp = batch_allocate_memory(gibibytes(64));
+	if (!buffer.data || !memory.data || !state.temp.data)
+	{
+		fprintf(stderr, "ninecalc_batch: out of address space\n");
+		return(1);
+	}
+
+	state.output.file   = 1;
+	state.output.size   = mebibytes(1);
+	state.output.buffer = (u8*)allocate_bytes(&memory, state.output.size);
+
+	Atom_Table atoms = make_atom_table(&memory, 256);
+	state.context = make_context(&memory, &atoms, 64);
+
+	if (thread_count > 1)
+	{
+		Batch_Pool *pool = allocate_struct(&memory, Batch_Pool);
+		*pool = {};
+		pool->worker_count = (u32)thread_count;
+		pool->workers = allocate_array(&memory, Batch_Worker, pool->worker_count);
+		pool->chunks  = allocate_array(&memory, Batch_Chunk, BATCH_WINDOW_CHUNKS);
+		for (u32 i = 0; i < pool->worker_count; ++i)
+		{
+			Batch_Worker *worker = pool->workers + i;
+			*worker = {};
+			worker->pool   = pool;
+			worker->window = batch_allocate_memory(gibibytes(64));
+			worker->temp   = batch_allocate_memory(gibibytes(64));
+			worker->memory = batch_allocate_memory(gibibytes(4));
+			if (!worker->window.data || !worker->temp.data || !worker->memory.data)
+			{
+				fprintf(stderr, "ninecalc_batch: out of address space\n");
+				return(1);
+			}
+			worker->atoms   = make_atom_table(&worker->memory, 256);
+			worker->context = make_context(&worker->memory, &worker->atoms, 8);
+		}
+		state.pool = pool;
+	}
+
+	u8 *document;
+	u64 document_size;
+	bool32 succeeded = true;
+	if (batch_map_file(input_file, &document, &document_size))
+	{
+		u8 *end = document + document_size;
+		u8 *rest = batch_evaluate_lines(&state, document, end);
+		if (rest < end)
+			batch_evaluate_line(&state, rest, end);
+	}
+	else
+		succeeded = batch_evaluate_stream(&state, input_file, &buffer);
+	batch_flush(&state.output);
+
+	if (!succeeded)
+	{
+		fprintf(stderr, "ninecalc_batch: can't read %s\n", input_name? input_name : "stdin");
+		return(1);
+	}
+	return(0);
+}
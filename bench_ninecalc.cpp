@@ -0,0 +1,487 @@
+// system headers first, grs.h defines a swap macro they would trip over
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "ninecalc.cpp"
+
+/*
+	Benchmarks the stages of the math engine one at a time, on generated documents that
+	each push on one part of it: short arithmetic, long operator chains, deep nesting,
+	many variables, long literals and factorials. The documents come from a fixed seed,
+	so every run measures the same lines.
+
+	Every stage gets what the one before it made, worked out ahead of time, and is timed
+	over the whole document, the best of a few passes. run_program is there next to
+	evaluate_tree, to compare the two engines; they have to agree on every line.
+
+	usage: ninecalc_bench [-n lines] [-r passes] [corpus...]
+
+	Prints JSON: for every corpus and stage, the time per line, tokens per second
+	and how many bytes the stage took from its arena per line.
+*/
+
+struct Bench_Corpus
+{
+	char        *name;
+	UTF8_String *lines;
+	u64         line_count;
+	u64         byte_count;
+};
+
+struct Bench_Random
+{
+	u64 state;
+};
+
+struct Bench_Stage
+{
+	char *name;
+	u64  items;     // what the stage works on: lines, literals or results
+	u64  best;      // nanoseconds, for the fastest pass
+	u64  total;     // nanoseconds, over all passes
+	u64  allocated; // bytes, in one pass
+};
+
+typedef void Bench_Generator(Memory_Arena*, Bench_Random*, u64);
+
+internal Memory_Arena
+bench_allocate_memory(u64 size)
+{
+	// only address space, pages are committed as they are touched
+	Memory_Arena memory = {};
+	void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (data != MAP_FAILED)
+	{
+		memory.data = (u8*)data;
+		memory.size = size;
+	}
+	return(memory);
+}
+
+internal inline u64
+current_nanoseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((u64)now.tv_sec * 1000000000 + now.tv_nsec);
+}
+
+internal inline u64
+next_random(Bench_Random *random)
+{
+	// xorshift64*
+	random->state ^= random->state >> 12;
+	random->state ^= random->state << 25;
+	random->state ^= random->state >> 27;
+	return(random->state * 0x2545F4914F6CDD1DULL);
+}
+
+internal inline u32
+random_below(Bench_Random *random, u32 bound)
+{
+	return((u32)(next_random(random) % bound));
+}
+
+internal inline char
+random_operator(Bench_Random *random)
+{
+	return("+-*/"[random_below(random, 4)]);
+}
+
+internal void
+bench_print(Memory_Arena *text, char *format, ...)
+{
+	// appends to the text being generated, without the terminator
+	va_list arguments;
+	va_start(arguments, format);
+	u64 room = text->size - text->used;
+	s32 length = vsnprintf((char*)text->data + text->used, room, format, arguments);
+	va_end(arguments);
+	assert(length >= 0 && (u64)length < room);
+	text->used += length;
+}
+
+internal void
+generate_short_arithmetic(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	// what most lines of a document look like
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		u32 operands = 2 + random_below(random, 3);
+		for (u32 j = 0; j < operands; ++j)
+		{
+			if (j)
+				bench_print(text, " %c ", random_operator(random));
+			if (random_below(random, 2))
+				bench_print(text, "%u", 1 + random_below(random, 1000));
+			else
+				bench_print(text, "%u.%02u", random_below(random, 100), random_below(random, 100));
+		}
+		bench_print(text, "\n");
+	}
+}
+
+internal void
+generate_operator_chains(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		bench_print(text, "%u", 1 + random_below(random, 9));
+		for (u32 j = 0; j < 63; ++j)
+		{
+			// no division, so the values stay where they can be told apart
+			char operator_symbol = "+-*"[random_below(random, 3)];
+			bench_print(text, " %c %u", operator_symbol, 1 + random_below(random, 9));
+		}
+		bench_print(text, "\n");
+	}
+}
+
+internal void
+generate_deep_nesting(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		u32 depth = 16 + random_below(random, 48);
+		for (u32 j = 0; j < depth; ++j)
+			bench_print(text, "(");
+		bench_print(text, "%u", 1 + random_below(random, 9));
+		for (u32 j = 0; j < depth; ++j)
+			bench_print(text, " %c %u)", random_operator(random), 1 + random_below(random, 9));
+		bench_print(text, "\n");
+	}
+}
+
+internal void
+generate_many_variables(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	// every line defines a variable from a few of the ones before it
+	bench_print(text, "rate_0 : 1.5\n");
+	for (u64 i = 1; i < line_count; ++i)
+	{
+		bench_print(text, "rate_%llu : rate_%u", i, random_below(random, (u32)i));
+		u32 reads = random_below(random, 4);
+		for (u32 j = 0; j < reads; ++j)
+			bench_print(text, " %c rate_%u", "+-*"[random_below(random, 3)], random_below(random, (u32)i));
+		bench_print(text, " %c prev\n", random_operator(random));
+	}
+}
+
+internal void
+generate_large_literals(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	// more digits than a double holds, separators and exponents, for the slow path of parse_float
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		for (u32 j = 0; j < 3; ++j)
+		{
+			if (j)
+				bench_print(text, " %c ", random_operator(random));
+			u32 kind = random_below(random, 3);
+			if (kind == 0)
+				bench_print(text, "%llu%llu.%llu", next_random(random) % 1000000000000ULL, next_random(random) % 1000000000ULL, next_random(random) % 1000000000000ULL);
+			else if (kind == 1)
+				bench_print(text, "%u_%03u_%03u.%03u", random_below(random, 1000), random_below(random, 1000), random_below(random, 1000), random_below(random, 1000));
+			else
+				bench_print(text, "%u.%08ue%d", 1 + random_below(random, 9), random_below(random, 100000000), (s32)random_below(random, 600) - 300);
+		}
+		bench_print(text, "\n");
+	}
+}
+
+internal void
+generate_factorials(Memory_Arena *text, Bench_Random *random, u64 line_count)
+{
+	// integers come from the table, halves go through tgamma
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		u32 kind = random_below(random, 3);
+		if (kind == 0)
+			bench_print(text, "%u!\n", random_below(random, 171));
+		else if (kind == 1)
+			bench_print(text, "%u.5! / %u!\n", random_below(random, 60), random_below(random, 60));
+		else
+			bench_print(text, "(%u! - %u!) * 2^%u\n", random_below(random, 30), random_below(random, 20), random_below(random, 17));
+	}
+}
+
+internal Bench_Corpus
+make_corpus(Memory_Arena *memory, char *name, Bench_Generator *generate, u64 line_count)
+{
+	Bench_Corpus corpus = {};
+	corpus.name = name;
+
+	Bench_Random random = { 0x9E3779B97F4A7C15ULL };
+	Memory_Arena text = { memory->data + memory->used, memory->size - memory->used, 0 };
+	generate(&text, &random, line_count);
+	u8 *data = (u8*)allocate_bytes(memory, text.used);
+	corpus.byte_count = text.used;
+
+	corpus.lines = allocate_array(memory, UTF8_String, line_count);
+	u64 start = 0;
+	for (u64 i = 0; i < text.used; ++i)
+	{
+		if (data[i] == '\n')
+		{
+			corpus.lines[corpus.line_count++] = { data + start, i - start };
+			start = i + 1;
+		}
+	}
+	return(corpus);
+}
+
+internal inline bool32
+results_agree(Result a, Result b)
+{
+	if (a.valid != b.valid)
+		return(false);
+	return(!a.valid || a.value == b.value || (a.value != a.value && b.value != b.value));
+}
+
+internal void
+print_stage(Bench_Corpus *corpus, Bench_Stage *stage, u64 token_count, u32 passes, bool32 first)
+{
+	f64 best = (f64)stage->best;
+	printf("%s\t\t{ \"corpus\": \"%s\", \"stage\": \"%s\", \"lines\": %llu, \"bytes\": %llu, \"tokens\": %llu, \"items\": %llu,\n",
+		first? "" : ",\n", corpus->name, stage->name, corpus->line_count, corpus->byte_count, token_count, stage->items);
+	printf("\t\t  \"ns_per_line\": %.1f, \"mean_ns_per_line\": %.1f, \"tokens_per_second\": %.0f, \"arena_bytes_per_line\": %.1f }",
+		(double)(best / corpus->line_count),
+		(double)((f64)stage->total / passes / corpus->line_count),
+		(double)(best? token_count / (best / 1e9) : 0),
+		(double)((f64)stage->allocated / corpus->line_count));
+}
+
+internal inline void
+time_pass(Bench_Stage *stage, u64 start)
+{
+	u64 elapsed = current_nanoseconds() - start;
+	if (elapsed < stage->best)
+		stage->best = elapsed;
+	stage->total += elapsed;
+}
+
+internal bool32
+benchmark_corpus(Memory_Arena *memory, Bench_Corpus *corpus, u32 passes, bool32 first)
+{
+	u64 memory_used = memory->used;
+	u64 line_count = corpus->line_count;
+
+	Memory_Arena atom_memory = allocate_arena(memory, mebibytes(64));
+	Atom_Table atoms = make_atom_table(&atom_memory, 64);
+
+	Token_List *tokens = allocate_array(memory, Token_List, line_count);
+	AST       **trees  = allocate_array(memory, AST*, line_count);
+	Program    *programs = allocate_array(memory, Program, line_count);
+	Result     *results  = allocate_array(memory, Result, line_count);
+	Memory_Arena temp      = allocate_arena(memory, mebibytes(64));
+	Memory_Arena variables = allocate_arena(memory, mebibytes(64));
+
+	enum { Tokenize, Parse, Evaluate_Tree, Run_Program, Parse_Float, Convert_F64, Stage_Count };
+	Bench_Stage stages[Stage_Count] = {
+		{ "tokenize_expression" },
+		{ "parse_tokens" },
+		{ "evaluate_tree" },
+		{ "run_program" },
+		{ "parse_float" },
+		{ "convert_f64_to_string" },
+	};
+	for (u32 i = 0; i < Stage_Count; ++i)
+		stages[i].best = 0xFFFFFFFFFFFFFFFFULL;
+
+	// what every stage starts from, kept for the ones after it
+	u64 token_count = 0;
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		tokens[i] = tokenize_expression(memory, corpus->lines[i], &atoms);
+		trees[i]  = parse_tokens(memory, tokens[i]);
+		programs[i] = compile_tree(memory, trees[i], tokens[i]);
+		token_count += tokens[i].count;
+	}
+
+	UTF8_String *literals = allocate_array(memory, UTF8_String, token_count);
+	u64 literal_count = 0;
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		for (u64 j = 0; j < tokens[i].count; ++j)
+		{
+			Token token = tokens[i][j];
+			if (token.type == Token_Type::Number)
+				literals[literal_count++] = substring(corpus->lines[i], token.offset, token.length);
+		}
+	}
+
+	for (u32 pass = 0; pass < passes; ++pass)
+	{
+		// one line at a time, with the arena emptied after each, the way the editor goes through a document
+		for (u32 i = 0; i < Stage_Count; ++i)
+			stages[i].allocated = 0;
+
+		u64 start = current_nanoseconds();
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			temp.used = 0;
+			tokenize_expression(&temp, corpus->lines[i], &atoms);
+			stages[Tokenize].allocated += temp.used;
+		}
+		time_pass(&stages[Tokenize], start);
+
+		start = current_nanoseconds();
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			temp.used = 0;
+			parse_tokens(&temp, tokens[i]);
+			stages[Parse].allocated += temp.used;
+		}
+		time_pass(&stages[Parse], start);
+
+		// the variables last the whole document, what they take is put down to evaluation
+		variables.used = 0;
+		Context context = make_context(&variables, &atoms, 64);
+		u64 context_used = variables.used;
+		start = current_nanoseconds();
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			results[i] = evaluate_tree(trees[i], &context);
+			if (results[i].valid)
+				add_or_update_variable(&context, Atom_Prev, results[i].value);
+		}
+		time_pass(&stages[Evaluate_Tree], start);
+		stages[Evaluate_Tree].allocated = variables.used - context_used;
+
+		variables.used = 0;
+		context = make_context(&variables, &atoms, 64);
+		bool32 agreed = true;
+		start = current_nanoseconds();
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			temp.used = 0;
+			Result result = run_program(&temp, programs + i, &context);
+			if (result.valid)
+				add_or_update_variable(&context, Atom_Prev, result.value);
+			agreed &= results_agree(result, results[i]);
+			stages[Run_Program].allocated += temp.used;
+		}
+		time_pass(&stages[Run_Program], start);
+		stages[Run_Program].allocated += variables.used - context_used;
+		if (!agreed)
+		{
+			fprintf(stderr, "ninecalc_bench: evaluate_tree and run_program disagree on %s\n", corpus->name);
+			return(false);
+		}
+
+		f64 checksum = 0;
+		start = current_nanoseconds();
+		for (u64 i = 0; i < literal_count; ++i)
+		{
+			f64 value;
+			if (parse_float(literals[i], &value))
+				checksum += value;
+		}
+		time_pass(&stages[Parse_Float], start);
+		// so the loop isn't thrown away
+		if (checksum == 42)
+			fprintf(stderr, " ");
+
+		u64 formatted = 0;
+		start = current_nanoseconds();
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			if (results[i].valid)
+			{
+				temp.used = 0;
+				convert_f64_to_string(&temp, results[i].value);
+				stages[Convert_F64].allocated += temp.used;
+				++formatted;
+			}
+		}
+		time_pass(&stages[Convert_F64], start);
+		stages[Convert_F64].items = formatted;
+	}
+	stages[Parse_Float].items = literal_count;
+	stages[Tokenize].items = stages[Parse].items = line_count;
+	stages[Evaluate_Tree].items = stages[Run_Program].items = line_count;
+
+	for (u32 i = 0; i < Stage_Count; ++i)
+		print_stage(corpus, stages + i, token_count, passes, first && i == 0);
+
+	memory->used = memory_used;
+	return(true);
+}
+
+int
+main(int argument_count, char **arguments)
+{
+	u64 line_count = 20000;
+	u32 passes = 5;
+
+	struct { char *name; Bench_Generator *generate; bool32 selected; } corpora[] =
+	{
+		{ "short",     generate_short_arithmetic },
+		{ "chains",    generate_operator_chains  },
+		{ "nesting",   generate_deep_nesting     },
+		{ "variables", generate_many_variables   },
+		{ "literals",  generate_large_literals   },
+		{ "factorials", generate_factorials      },
+	};
+
+	bool32 any_selected = false;
+	for (s32 i = 1; i < argument_count; ++i)
+	{
+		if (!strcmp(arguments[i], "-n") && i + 1 < argument_count)
+			line_count = strtoull(arguments[++i], 0, 10);
+		else if (!strcmp(arguments[i], "-r") && i + 1 < argument_count)
+			passes = (u32)strtoul(arguments[++i], 0, 10);
+		else
+		{
+			bool32 found = false;
+			for (u32 j = 0; j < array_count(corpora); ++j)
+			{
+				if (!strcmp(arguments[i], corpora[j].name))
+					found = corpora[j].selected = true;
+			}
+			if (!found)
+			{
+				fprintf(stderr, "usage: ninecalc_bench [-n lines] [-r passes] [corpus...]\ncorpora:");
+				for (u32 j = 0; j < array_count(corpora); ++j)
+					fprintf(stderr, " %s", corpora[j].name);
+				fprintf(stderr, "\n");
+				return(1);
+			}
+			any_selected = true;
+		}
+	}
+	if (!line_count || !passes)
+	{
+		fprintf(stderr, "ninecalc_bench: need at least one line and one pass\n");
+		return(1);
+	}
+
+	Memory_Arena memory = bench_allocate_memory(gibibytes(64));
+	if (!memory.data)
+	{
+		fprintf(stderr, "ninecalc_bench: out of memory\n");
+		return(1);
+	}
+
+	printf("{\n\t\"lines\": %llu,\n\t\"passes\": %u,\n\t\"results\": [\n", line_count, passes);
+	bool32 succeeded = true;
+	bool32 first = true;
+	for (u32 i = 0; i < array_count(corpora) && succeeded; ++i)
+	{
+		if (any_selected && !corpora[i].selected)
+			continue;
+		u64 used = memory.used;
+		Bench_Corpus corpus = make_corpus(&memory, corpora[i].name, corpora[i].generate, line_count);
+		succeeded = benchmark_corpus(&memory, &corpus, passes, first);
+		first = false;
+		memory.used = used;
+	}
+	printf("\n\t]\n}\n");
+
+	return(succeeded? 0 : 1);
+}
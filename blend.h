@@ -0,0 +1,449 @@
+#pragma once
+#include "grs.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#define BLEND_SIMD 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define BLEND_AVX2
+	#else
+		// the AVX2 kernels are compiled for it whatever the rest is built for, and only run where it is there
+		#define BLEND_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+/*
+	Compositing of ARGB pixels, a row at a time. Every kernel gives exactly what
+	alpha_blend gives, pixel for pixel: the SIMD ones take 4 or 8 pixels at a time when
+	all of them are opaque, which the canvas is everywhere once its background is drawn,
+	and leave the rest to alpha_blend. select_blend_kernels picks the widest the CPU runs.
+
+	An opaque color covers whatever is under it, so filling with one only writes. Fills
+	bigger than the caches are streamed past them, and have to end with finish_streaming.
+*/
+
+// fills with more bytes than this go past the caches
+#define BLEND_STREAMING_BYTES (8 << 20)
+
+typedef void Blend_Fill_Span(u32 *destination, u32 count, u32 color);
+
+typedef void Blend_Color_Span(u32 *destination, u32 count, u32 color);
+typedef void Blend_Bitmap_Span(u32 *destination, u32 *source, u32 count);
+typedef void Blend_Coverage_Span(u32 *destination, u8 *coverage, u32 count, u32 color); // color, its alpha scaled by coverage
+
+struct Blend_Kernels
+{
+	char *name;
+	Blend_Fill_Span     *fill_span;
+	Blend_Fill_Span     *stream_span;
+	Blend_Color_Span    *color_span;
+	Blend_Bitmap_Span   *bitmap_span;
+	Blend_Coverage_Span *coverage_span;
+};
+
+internal inline u32
+alpha_blend(u32 source, u32 destination)
+{
+	u32 result;
+
+	u32 source_alpha		= (source      >> 24) & 0xFF;
+	u32 destination_alpha	= (destination >> 24) & 0xFF;
+	u32 complement_alpha	= destination_alpha * (255 - source_alpha) / 255;
+	u32 out_alpha			= source_alpha + complement_alpha;
+
+	if (out_alpha)
+	{
+		u32 source_red   = (source >> 16) & 0xFF;
+		u32 source_green = (source >>  8) & 0xFF;
+		u32 source_blue  = (source >>  0) & 0xFF;
+
+		u32 destination_red   = (destination >> 16) & 0xFF;
+		u32 destination_green = (destination >>  8) & 0xFF;
+		u32 destination_blue  = (destination >>  0) & 0xFF;
+
+		u8 out_red   = (u8)((source_red   * source_alpha + destination_red   * complement_alpha) / out_alpha);
+		u8 out_green = (u8)((source_green * source_alpha + destination_green * complement_alpha) / out_alpha);
+		u8 out_blue  = (u8)((source_blue  * source_alpha + destination_blue  * complement_alpha) / out_alpha);
+
+		result = (out_alpha << 24) | ((u32)out_red << 16) | ((u32)out_green << 8) | (u32)out_blue;
+	}
+	else
+	{
+		result = 0;
+	}
+
+	return(result);
+}
+
+internal inline u32
+scale_alpha(u32 color, u8 coverage)
+{
+	u32 alpha = ((u32)coverage * (color >> 24)) / 255;
+	return((color & 0x00FFFFFF) | (alpha << 24));
+}
+
+internal void
+fill_span_scalar(u32 *destination, u32 count, u32 color)
+{
+	for (u32 i = 0; i < count; ++i)
+		destination[i] = color;
+}
+
+internal void
+blend_color_span_scalar(u32 *destination, u32 count, u32 color)
+{
+	for (u32 i = 0; i < count; ++i)
+		destination[i] = alpha_blend(color, destination[i]);
+}
+
+internal void
+blend_bitmap_span_scalar(u32 *destination, u32 *source, u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+		destination[i] = alpha_blend(source[i], destination[i]);
+}
+
+internal void
+blend_coverage_span_scalar(u32 *destination, u8 *coverage, u32 count, u32 color)
+{
+	for (u32 i = 0; i < count; ++i)
+		destination[i] = alpha_blend(scale_alpha(color, coverage[i]), destination[i]);
+}
+
+global Blend_Kernels blend_kernels = { "scalar", fill_span_scalar, fill_span_scalar, blend_color_span_scalar, blend_bitmap_span_scalar, blend_coverage_span_scalar };
+
+#if BLEND_SIMD
+
+/*
+	Over an opaque destination, alpha_blend comes down to
+		out = (source * alpha + destination * (255 - alpha)) / 255, with an alpha of 255,
+	which fits 16 bits per channel. Pixels are spread to 16 bits in two halves, lo and hi,
+	and alpha is spread to the 4 channels of each pixel to go with them.
+*/
+
+internal inline u32
+load_coverage(u8 *coverage)
+{
+	return((u32)coverage[0] | ((u32)coverage[1] << 8) | ((u32)coverage[2] << 16) | ((u32)coverage[3] << 24));
+}
+
+internal inline __m128i
+divide_by_255(__m128i x)
+{
+	// exact for anything up to 255 * 255
+	return(_mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8));
+}
+
+internal inline bool32
+are_opaque(__m128i pixels)
+{
+	__m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	return(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(pixels, alpha), alpha)) == 0xFFFF);
+}
+
+internal inline void
+spread_alpha(__m128i alpha, __m128i *alpha_lo, __m128i *alpha_hi)
+{
+	// one alpha in the low byte of each pixel, to all 4 of its channels
+	__m128i twice = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+	*alpha_lo = _mm_unpacklo_epi32(twice, twice);
+	*alpha_hi = _mm_unpackhi_epi32(twice, twice);
+}
+
+internal inline __m128i
+blend_over_opaque(__m128i destination, __m128i source_lo, __m128i source_hi, __m128i alpha_lo, __m128i alpha_hi)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i full = _mm_set1_epi16(255);
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(source_lo, alpha_lo),
+		_mm_mullo_epi16(_mm_unpacklo_epi8(destination, zero), _mm_sub_epi16(full, alpha_lo)));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(source_hi, alpha_hi),
+		_mm_mullo_epi16(_mm_unpackhi_epi8(destination, zero), _mm_sub_epi16(full, alpha_hi)));
+	__m128i result = _mm_packus_epi16(divide_by_255(lo), divide_by_255(hi));
+	return(_mm_or_si128(result, _mm_set1_epi32((int)0xFF000000)));
+}
+
+internal void
+fill_span_sse2(u32 *destination, u32 count, u32 color)
+{
+	__m128i pixels = _mm_set1_epi32((int)color);
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i*)(destination + i), pixels);
+	fill_span_scalar(destination + i, count - i, color);
+}
+
+internal void
+stream_span_sse2(u32 *destination, u32 count, u32 color)
+{
+	// non-temporal stores only go to aligned addresses
+	u32 head = (u32)minimum(((16 - ((u64)destination & 15)) & 15) / 4, count);
+	fill_span_scalar(destination, head, color);
+
+	__m128i pixels = _mm_set1_epi32((int)color);
+	u32 i = head;
+	for (; i + 4 <= count; i += 4)
+		_mm_stream_si128((__m128i*)(destination + i), pixels);
+	fill_span_scalar(destination + i, count - i, color);
+}
+
+internal void
+blend_color_span_sse2(u32 *destination, u32 count, u32 color)
+{
+	__m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128());
+	__m128i alpha  = _mm_set1_epi16((short)(color >> 24));
+
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((__m128i*)(destination + i));
+		if (are_opaque(pixels))
+			_mm_storeu_si128((__m128i*)(destination + i), blend_over_opaque(pixels, source, source, alpha, alpha));
+		else
+			blend_color_span_scalar(destination + i, 4, color);
+	}
+	blend_color_span_scalar(destination + i, count - i, color);
+}
+
+internal void
+blend_bitmap_span_sse2(u32 *destination, u32 *source, u32 count)
+{
+	__m128i zero = _mm_setzero_si128();
+
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((__m128i*)(destination + i));
+		if (are_opaque(pixels))
+		{
+			__m128i source_pixels = _mm_loadu_si128((__m128i*)(source + i));
+			__m128i alpha_lo, alpha_hi;
+			spread_alpha(_mm_srli_epi32(source_pixels, 24), &alpha_lo, &alpha_hi);
+			_mm_storeu_si128((__m128i*)(destination + i), blend_over_opaque(pixels,
+				_mm_unpacklo_epi8(source_pixels, zero), _mm_unpackhi_epi8(source_pixels, zero), alpha_lo, alpha_hi));
+		}
+		else
+			blend_bitmap_span_scalar(destination + i, source + i, 4);
+	}
+	blend_bitmap_span_scalar(destination + i, source + i, count - i);
+}
+
+internal void
+blend_coverage_span_sse2(u32 *destination, u8 *coverage, u32 count, u32 color)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i solid  = _mm_set1_epi32((int)color);
+	__m128i source = _mm_unpacklo_epi8(solid, zero);
+	__m128i color_alpha = _mm_set1_epi16((short)(color >> 24));
+	bool32 color_is_opaque = (color >> 24) == 255;
+
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		// most of a glyph is either outside it or inside it
+		u32 covered_bits = load_coverage(coverage + i);
+		if (covered_bits == 0xFFFFFFFF && color_is_opaque)
+		{
+			_mm_storeu_si128((__m128i*)(destination + i), solid);
+			continue;
+		}
+
+		__m128i pixels = _mm_loadu_si128((__m128i*)(destination + i));
+		if (are_opaque(pixels))
+		{
+			if (!covered_bits)
+				continue;
+			__m128i covered = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)covered_bits), zero);
+			__m128i alpha = divide_by_255(_mm_mullo_epi16(covered, color_alpha));
+			__m128i alpha_lo, alpha_hi;
+			spread_alpha(_mm_unpacklo_epi16(alpha, zero), &alpha_lo, &alpha_hi);
+			_mm_storeu_si128((__m128i*)(destination + i), blend_over_opaque(pixels, source, source, alpha_lo, alpha_hi));
+		}
+		else
+			blend_coverage_span_scalar(destination + i, coverage + i, 4, color);
+	}
+	blend_coverage_span_scalar(destination + i, coverage + i, count - i, color);
+}
+
+// the same, 8 pixels at a time; unpacking and packing stay within each 128 bit half
+
+BLEND_AVX2 internal inline __m256i
+divide_by_255_avx2(__m256i x)
+{
+	return(_mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8));
+}
+
+BLEND_AVX2 internal inline bool32
+are_opaque_avx2(__m256i pixels)
+{
+	__m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	return((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(pixels, alpha), alpha)) == 0xFFFFFFFF);
+}
+
+BLEND_AVX2 internal inline void
+spread_alpha_avx2(__m256i alpha, __m256i *alpha_lo, __m256i *alpha_hi)
+{
+	__m256i twice = _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16));
+	*alpha_lo = _mm256_unpacklo_epi32(twice, twice);
+	*alpha_hi = _mm256_unpackhi_epi32(twice, twice);
+}
+
+BLEND_AVX2 internal inline __m256i
+blend_over_opaque_avx2(__m256i destination, __m256i source_lo, __m256i source_hi, __m256i alpha_lo, __m256i alpha_hi)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i full = _mm256_set1_epi16(255);
+	__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(source_lo, alpha_lo),
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(destination, zero), _mm256_sub_epi16(full, alpha_lo)));
+	__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(source_hi, alpha_hi),
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(destination, zero), _mm256_sub_epi16(full, alpha_hi)));
+	__m256i result = _mm256_packus_epi16(divide_by_255_avx2(lo), divide_by_255_avx2(hi));
+	return(_mm256_or_si256(result, _mm256_set1_epi32((int)0xFF000000)));
+}
+
+BLEND_AVX2 internal void
+fill_span_avx2(u32 *destination, u32 count, u32 color)
+{
+	__m256i pixels = _mm256_set1_epi32((int)color);
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256((__m256i*)(destination + i), pixels);
+	fill_span_sse2(destination + i, count - i, color);
+}
+
+BLEND_AVX2 internal void
+stream_span_avx2(u32 *destination, u32 count, u32 color)
+{
+	u32 head = (u32)minimum(((32 - ((u64)destination & 31)) & 31) / 4, count);
+	fill_span_scalar(destination, head, color);
+
+	__m256i pixels = _mm256_set1_epi32((int)color);
+	u32 i = head;
+	for (; i + 8 <= count; i += 8)
+		_mm256_stream_si256((__m256i*)(destination + i), pixels);
+	fill_span_scalar(destination + i, count - i, color);
+}
+
+BLEND_AVX2 internal void
+blend_color_span_avx2(u32 *destination, u32 count, u32 color)
+{
+	__m256i source = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)color), _mm256_setzero_si256());
+	__m256i alpha  = _mm256_set1_epi16((short)(color >> 24));
+
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i pixels = _mm256_loadu_si256((__m256i*)(destination + i));
+		if (are_opaque_avx2(pixels))
+			_mm256_storeu_si256((__m256i*)(destination + i), blend_over_opaque_avx2(pixels, source, source, alpha, alpha));
+		else
+			blend_color_span_scalar(destination + i, 8, color);
+	}
+	blend_color_span_sse2(destination + i, count - i, color);
+}
+
+BLEND_AVX2 internal void
+blend_bitmap_span_avx2(u32 *destination, u32 *source, u32 count)
+{
+	__m256i zero = _mm256_setzero_si256();
+
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i pixels = _mm256_loadu_si256((__m256i*)(destination + i));
+		if (are_opaque_avx2(pixels))
+		{
+			__m256i source_pixels = _mm256_loadu_si256((__m256i*)(source + i));
+			__m256i alpha_lo, alpha_hi;
+			spread_alpha_avx2(_mm256_srli_epi32(source_pixels, 24), &alpha_lo, &alpha_hi);
+			_mm256_storeu_si256((__m256i*)(destination + i), blend_over_opaque_avx2(pixels,
+				_mm256_unpacklo_epi8(source_pixels, zero), _mm256_unpackhi_epi8(source_pixels, zero), alpha_lo, alpha_hi));
+		}
+		else
+			blend_bitmap_span_scalar(destination + i, source + i, 8);
+	}
+	blend_bitmap_span_sse2(destination + i, source + i, count - i);
+}
+
+BLEND_AVX2 internal void
+blend_coverage_span_avx2(u32 *destination, u8 *coverage, u32 count, u32 color)
+{
+	__m256i solid  = _mm256_set1_epi32((int)color);
+	__m256i source = _mm256_unpacklo_epi8(solid, _mm256_setzero_si256());
+	__m128i color_alpha = _mm_set1_epi16((short)(color >> 24));
+	bool32 color_is_opaque = (color >> 24) == 255;
+
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i covered_bits = _mm_loadl_epi64((__m128i*)(coverage + i));
+		u32 empty = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(covered_bits, _mm_setzero_si128())) & 0xFF;
+		u32 full  = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(covered_bits, _mm_set1_epi8(-1))) & 0xFF;
+		if (full == 0xFF && color_is_opaque)
+		{
+			_mm256_storeu_si256((__m256i*)(destination + i), solid);
+			continue;
+		}
+
+		__m256i pixels = _mm256_loadu_si256((__m256i*)(destination + i));
+		if (are_opaque_avx2(pixels))
+		{
+			if (empty == 0xFF)
+				continue;
+			__m128i covered = _mm_unpacklo_epi8(covered_bits, _mm_setzero_si128());
+			__m128i alpha = divide_by_255(_mm_mullo_epi16(covered, color_alpha));
+			__m256i alpha_lo, alpha_hi;
+			spread_alpha_avx2(_mm256_cvtepu16_epi32(alpha), &alpha_lo, &alpha_hi);
+			_mm256_storeu_si256((__m256i*)(destination + i), blend_over_opaque_avx2(pixels, source, source, alpha_lo, alpha_hi));
+		}
+		else
+			blend_coverage_span_scalar(destination + i, coverage + i, 8, color);
+	}
+	blend_coverage_span_sse2(destination + i, coverage + i, count - i, color);
+}
+
+internal bool32
+cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+	// and an OS that saves the YMM registers
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return(false);
+	__cpuid(info, 1);
+	bool32 has_osxsave = (info[2] >> 27) & 1;
+	bool32 has_avx     = (info[2] >> 28) & 1;
+	if (!has_osxsave || !has_avx || (_xgetbv(0) & 6) != 6)
+		return(false);
+	__cpuidex(info, 7, 0);
+	return((info[1] >> 5) & 1);
+#else
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("avx2"));
+#endif
+}
+
+#endif
+
+internal inline void
+finish_streaming()
+{
+	// streamed stores are only ordered with the ones after them by a fence
+#if BLEND_SIMD
+	_mm_sfence();
+#endif
+}
+
+internal Blend_Kernels
+select_blend_kernels()
+{
+	Blend_Kernels kernels = { "scalar", fill_span_scalar, fill_span_scalar, blend_color_span_scalar, blend_bitmap_span_scalar, blend_coverage_span_scalar };
+#if BLEND_SIMD
+	kernels = { "sse2", fill_span_sse2, stream_span_sse2, blend_color_span_sse2, blend_bitmap_span_sse2, blend_coverage_span_sse2 };
+	if (cpu_has_avx2())
+		kernels = { "avx2", fill_span_avx2, stream_span_avx2, blend_color_span_avx2, blend_bitmap_span_avx2, blend_coverage_span_avx2 };
+#endif
+	return(kernels);
+}
@@ -0,0 +1,13 @@
+#!/bin/sh
+# Linux targets. The editor itself builds on Windows, with build.cmd.
+ignoredWarnings="-Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable -Wno-write-strings -Wno-sequence-point"
+compileFlags="-std=c++17 -Wall -Werror $ignoredWarnings -fno-rtti -O2 -g"
+defineFlags=""
+
+mkdir -p build
+cd build
+	g++ $compileFlags $defineFlags ../batch_ninecalc.cpp -o ninecalc_batch
+	g++ $compileFlags $defineFlags -DSTB_TRUETYPE_IMPLEMENTATION -DPROFILE ../headless_ninecalc.cpp -o ninecalc_headless
+	g++ $compileFlags $defineFlags ../bench_ninecalc.cpp -o ninecalc_bench
+	g++ $compileFlags $defineFlags ../test_ninecalc.cpp -o ninecalc_test
+cd ..
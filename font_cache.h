@@ -0,0 +1,211 @@
+#pragma once
+#include "ninecalc.h"
+
+/*
+	Font cache files: the printable Latin-1 glyphs of a font at one line height, rasterized
+	and packed ahead of time, so that a platform layer can map the file and the font draws
+	straight from it. A cache names the font file by its hash; one that doesn't match the
+	font, or that doesn't add up, is not used, and a new one can be made in its place.
+
+	The file is a Font_Cache_Header, then the code points, ascending, then a Glyph for each,
+	then the coverage the glyphs' offsets are in, stride bytes to a row.
+*/
+
+#define FONT_CACHE_MAGIC   0x544E4639 // "9FNT"
+#define FONT_CACHE_VERSION 1
+#define FONT_CACHE_GLYPHS  224        // at most, from 32 to 255
+
+struct Font_Cache_Header
+{
+	u32 magic;
+	u32 version;
+	u64 font_hash; // of the whole font file
+
+	// what the font has to have been loaded with
+	u32 line_height;
+	u32 baseline;
+	u32 cell_width;
+	u32 cell_height;
+
+	u32 glyph_count;
+	u32 stride;
+	u32 height;
+	u32 unused;
+};
+
+struct Font_Cache_Layout
+{
+	u64 code_points;
+	u64 glyphs;
+	u64 coverage;
+	u64 size;
+};
+
+internal Font_Cache_Layout
+get_font_cache_layout(u32 glyph_count, u32 stride, u32 height)
+{
+	Font_Cache_Layout layout;
+	layout.code_points = sizeof(Font_Cache_Header);
+	layout.glyphs      = (layout.code_points + glyph_count * sizeof(u32) + 15) & ~15ull;
+	layout.coverage    = (layout.glyphs + glyph_count * sizeof(Glyph) + 63) & ~63ull;
+	layout.size        = layout.coverage + (u64)stride * height;
+	return(layout);
+}
+
+internal u64
+hash_font_file(u8 *data, u64 size)
+{
+	// 8 bytes at a time in four lanes, as it is done on every start; data is aligned
+	u64 lanes[4] = { 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull };
+	u64 i = 0;
+	for (; i + 32 <= size; i += 32)
+	{
+		for (u32 lane = 0; lane < 4; lane++)
+		{
+			lanes[lane] = (lanes[lane] ^ *(u64*)(data + i + lane * 8)) * 0xFF51AFD7ED558CCDull;
+			lanes[lane] ^= lanes[lane] >> 32;
+		}
+	}
+
+	u64 hash = size;
+	for (u32 lane = 0; lane < 4; lane++)
+		hash = (hash ^ lanes[lane]) * 0xC4CEB9FE1A85EC53ull;
+	for (; i < size; i++)
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	return(hash ^ (hash >> 29));
+}
+
+internal UTF8_String
+make_font_cache(Memory_Arena *arena, Font *font, u64 font_hash)
+{
+	u32 cell_width  = font->atlas.stride;
+	u32 cell_height = font->atlas.cell_height;
+	u64 cell_size   = (u64)cell_width * cell_height;
+
+	// each to a cell of its own first, to know how big it comes out
+	u32   code_points[FONT_CACHE_GLYPHS];
+	Glyph glyphs[FONT_CACHE_GLYPHS];
+	u32   glyph_count = 0;
+	u8 *cells = (u8*)allocate_bytes(arena, FONT_CACHE_GLYPHS * cell_size);
+	for (u32 codepoint = 32; codepoint < 256; codepoint++)
+	{
+		Glyph glyph = {};
+		if (codepoint_is_printable(codepoint) &&
+			font->rasterize_glyph(font, codepoint, &glyph, cells + glyph_count * cell_size, cell_width))
+		{
+			code_points[glyph_count] = codepoint;
+			glyphs[glyph_count++] = glyph;
+		}
+	}
+
+	// in shelves, tallest first, each as tall as the first glyph on it
+	u32 stride = 256;
+	while (stride < cell_width)
+		stride *= 2;
+
+	u32 order[FONT_CACHE_GLYPHS];
+	for (u32 i = 0; i < glyph_count; i++)
+	{
+		u32 j = i;
+		for (; j > 0 && glyphs[order[j - 1]].height < glyphs[i].height; --j)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	u32 shelf_x = 0;
+	u32 shelf_y = 0;
+	u32 shelf_height = 0;
+	for (u32 i = 0; i < glyph_count; i++)
+	{
+		Glyph *glyph = glyphs + order[i];
+		if (shelf_x + glyph->width > stride)
+		{
+			shelf_y += shelf_height;
+			shelf_x = 0;
+			shelf_height = 0;
+		}
+		if (!shelf_height)
+			shelf_height = glyph->height;
+
+		glyph->offset = shelf_y * stride + shelf_x;
+		glyph->pinned = true;
+		shelf_x += glyph->width;
+	}
+	u32 height = shelf_y + shelf_height;
+
+	Font_Cache_Layout layout = get_font_cache_layout(glyph_count, stride, height);
+	UTF8_String image = { (u8*)allocate_bytes(arena, layout.size, 64), layout.size };
+	for (u64 i = 0; i < image.length; i++)
+		image.data[i] = 0;
+
+	Font_Cache_Header *header = (Font_Cache_Header*)image.data;
+	header->magic       = FONT_CACHE_MAGIC;
+	header->version     = FONT_CACHE_VERSION;
+	header->font_hash   = font_hash;
+	header->line_height = font->line_height;
+	header->baseline    = font->baseline;
+	header->cell_width  = cell_width;
+	header->cell_height = cell_height;
+	header->glyph_count = glyph_count;
+	header->stride      = stride;
+	header->height      = height;
+
+	u32   *stored_code_points = (u32*)(image.data + layout.code_points);
+	Glyph *stored_glyphs      = (Glyph*)(image.data + layout.glyphs);
+	u8    *coverage           = image.data + layout.coverage;
+	for (u32 i = 0; i < glyph_count; i++)
+	{
+		stored_code_points[i] = code_points[i];
+		stored_glyphs[i] = glyphs[i];
+		for (u32 y = 0; y < glyphs[i].height; y++)
+		{
+			for (u32 x = 0; x < glyphs[i].width; x++)
+				coverage[glyphs[i].offset + y * stride + x] = cells[i * cell_size + y * cell_width + x];
+		}
+	}
+
+	return(image);
+}
+
+internal bool32
+attach_font_cache(Font *font, u8 *image, u64 size, u64 font_hash)
+{
+	// before any glyph has been looked up; the font draws from image from then on
+	if (size < sizeof(Font_Cache_Header))
+		return(false);
+
+	Font_Cache_Header *header = (Font_Cache_Header*)image;
+	if (header->magic       != FONT_CACHE_MAGIC   ||
+		header->version     != FONT_CACHE_VERSION ||
+		header->font_hash   != font_hash          ||
+		header->line_height != font->line_height  ||
+		header->baseline    != font->baseline     ||
+		header->cell_width  != font->atlas.stride ||
+		header->cell_height != font->atlas.cell_height ||
+		header->glyph_count >  FONT_CACHE_GLYPHS  ||
+		header->stride      <  header->cell_width)
+		return(false);
+
+	Font_Cache_Layout layout = get_font_cache_layout(header->glyph_count, header->stride, header->height);
+	if (size < layout.size)
+		return(false);
+
+	u32   *code_points   = (u32*)(image + layout.code_points);
+	Glyph *glyphs        = (Glyph*)(image + layout.glyphs);
+	u64    coverage_size = (u64)header->stride * header->height;
+	for (u32 i = 0; i < header->glyph_count; i++)
+	{
+		Glyph glyph = glyphs[i];
+		bool32 fits = glyph.width <= header->cell_width && glyph.height <= header->cell_height &&
+			(!glyph.height || glyph.offset + (u64)(glyph.height - 1) * header->stride + glyph.width <= coverage_size);
+		if (code_points[i] >= 256 || (i && code_points[i] <= code_points[i - 1]) || !glyph.pinned || !fits)
+			return(false);
+	}
+
+	font->pinned_glyphs = glyphs;
+	font->pinned_atlas  = { image + layout.coverage, header->stride, header->height, 0 };
+	for (u32 i = 0; i < header->glyph_count; i++)
+		font->latin_glyphs[code_points[i]] = (u16)(GLYPH_SLOT_COUNT + i);
+
+	return(true);
+}
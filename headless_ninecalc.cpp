@@ -0,0 +1,525 @@
+// system headers first, grs.h defines a swap macro they would trip over
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ninecalc.cpp"
+#include "truetype_font.h"
+
+/*
+	Headless NineCalc: runs update_and_render on a canvas in memory, with input from a script,
+	and reports how long each frame took. Runs from the repository root, like the editor,
+	so that data/ is where it looks for the font.
+
+	usage: ninecalc_headless [script]    reads stdin when no script is given
+
+	The script has one command per line. Input adds up until a frame runs it, and like with
+	a real frame, keys are handled before typed text; run a frame in between when order matters.
+	The editor only looks at whether the mouse buttons are down, so a click is
+	hold mouse_left, frame, release mouse_left; press would be down and up again by the frame.
+
+		size <width> <height>   resize the canvas, as resizing the window would
+		type <text>             the rest of the line, as typed characters
+		press <key>             up right down left enter backspace delete home end cut
+		                        copy paste save
+		hold <key>              press it and keep it down: any key above, or mouse_left
+		                        mouse_right mouse_middle
+		release <key>
+		mouse <x> <y>           move the mouse
+		clipboard <text>        what paste gets, \n being a newline
+		frame [count]           run frames, 1/30 s apart
+		dump <file.ppm>         write the canvas as it is
+		trace <file> [frames]   write the last frames (all there are) as Chrome trace events,
+		                        when built with PROFILE
+		# comment
+
+	Prints "frame<TAB>microseconds<TAB>pixels" for every frame, pixels being how many of
+	them it changed, and a summary to stderr.
+*/
+
+struct Headless_Clipboard
+{
+	u32 data[4096];
+	u64 length;
+};
+
+global Headless_Clipboard clipboard;
+
+internal Memory_Arena
+headless_allocate_memory(u64 size)
+{
+	Memory_Arena memory = {};
+	void *data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data != MAP_FAILED)
+	{
+		memory.data = (u8*)data;
+		memory.size = size;
+	}
+	return(memory);
+}
+
+internal u8 *
+headless_read_file(char *file_path, u64 *size)
+{
+	u8 *buffer = 0;
+	int file = open(file_path, O_RDONLY);
+	struct stat status;
+	if (file >= 0 && !fstat(file, &status))
+	{
+		buffer = (u8*)malloc(status.st_size + 1);
+		u64 bytes_read = 0;
+		while (buffer && bytes_read < (u64)status.st_size)
+		{
+			ssize_t result = read(file, buffer + bytes_read, status.st_size - bytes_read);
+			if (result <= 0)
+			{
+				free(buffer);
+				buffer = 0;
+			}
+			else
+				bytes_read += result;
+		}
+		if (buffer)
+		{
+			buffer[bytes_read] = 0;
+			*size = bytes_read;
+		}
+	}
+	if (file >= 0)
+		close(file);
+	return(buffer);
+}
+
+internal u8 *
+headless_map_file(char *file_path, u64 *size)
+{
+	u8 *view = 0;
+	int file = open(file_path, O_RDONLY);
+	struct stat status;
+	if (file >= 0 && !fstat(file, &status) && status.st_size > 0)
+	{
+		void *mapped = mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapped != MAP_FAILED)
+		{
+			view = (u8*)mapped;
+			*size = status.st_size;
+		}
+	}
+	if (file >= 0)
+		close(file);
+	return(view);
+}
+
+internal bool32
+headless_replace_file(char *file_path, UTF8_String contents)
+{
+	// written next to it first, so nothing ever maps half a file
+	char temporary_path[1024 + 8];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.new", file_path);
+	FILE *file = fopen(temporary_path, "wb");
+	bool32 succeeded = file && fwrite(contents.data, 1, contents.length, file) == contents.length;
+	if (file && fclose(file))
+		succeeded = false;
+	if (succeeded && rename(temporary_path, file_path))
+		succeeded = false;
+	if (!succeeded)
+		remove(temporary_path);
+	return(succeeded);
+}
+
+Font
+headless_load_font(Memory_Arena *memory, char *ttf_filepath, u32 line_height)
+{
+	u64 size;
+	u8 *font_data = headless_read_file(ttf_filepath, &size);
+	if (!font_data)
+	{
+		fprintf(stderr, "ninecalc_headless: can't read %s\n", ttf_filepath);
+		exit(1);
+	}
+	// kept, glyphs are rasterized from it as they are needed
+	Font loaded_font = load_font_from_ttf(memory, font_data, line_height);
+
+	// the common glyphs come from a cache file, made the first time
+	u64 font_hash = hash_font_file(font_data, size);
+	char cache_path[1024];
+	snprintf(cache_path, sizeof(cache_path), "%s.%u.glyphs", ttf_filepath, line_height);
+
+	u64 cache_size = 0;
+	u8 *cache = headless_map_file(cache_path, &cache_size);
+	if (!cache || !attach_font_cache(&loaded_font, cache, cache_size, font_hash))
+	{
+		if (cache)
+			munmap(cache, cache_size);
+
+		u64 used = memory->used;
+		bool32 written = headless_replace_file(cache_path, make_font_cache(memory, &loaded_font, font_hash));
+		memory->used = used;
+
+		cache = written? headless_map_file(cache_path, &cache_size) : 0;
+		if (cache && !attach_font_cache(&loaded_font, cache, cache_size, font_hash))
+			munmap(cache, cache_size);
+	}
+
+	return(loaded_font);
+}
+
+bool32
+headless_push_to_clipboard(UTF32_String text)
+{
+	if (text.length > array_count(clipboard.data))
+		return(false);
+	for (u64 i = 0; i < text.length; ++i)
+		clipboard.data[i] = text.data[i];
+	clipboard.length = text.length;
+	return(true);
+}
+
+UTF32_String
+headless_pop_from_clipboard(Memory_Arena *arena)
+{
+	UTF32_String result = make_empty_string(arena, clipboard.length);
+	for (u64 i = 0; i < clipboard.length; ++i)
+		result.data[i] = clipboard.data[i];
+	result.length = clipboard.length;
+	return(result);
+}
+
+internal void
+headless_resize_canvas(Canvas *canvas, u32 width, u32 height)
+{
+	free(canvas->buffer);
+	canvas->width  = width;
+	canvas->height = height;
+	canvas->buffer = (u32*)calloc((u64)width * height, sizeof(u32));
+	canvas->contents_lost = true;
+}
+
+internal bool32
+headless_dump_canvas(Canvas *canvas, char *file_path)
+{
+	FILE *file = fopen(file_path, "wb");
+	if (!file)
+		return(false);
+
+	fprintf(file, "P6\n%u %u\n255\n", canvas->width, canvas->height);
+	u8 *row = (u8*)malloc(3 * (u64)canvas->width);
+	for (u32 y = 0; y < canvas->height; ++y)
+	{
+		for (u32 x = 0; x < canvas->width; ++x)
+		{
+			u32 pixel = canvas->buffer[y * canvas->width + x];
+			row[3 * x + 0] = (u8)(pixel >> 16);
+			row[3 * x + 1] = (u8)(pixel >>  8);
+			row[3 * x + 2] = (u8)(pixel >>  0);
+		}
+		fwrite(row, 3, canvas->width, file);
+	}
+	free(row);
+	return(!fclose(file));
+}
+
+internal void
+headless_update_button(Input_Button *button, bool is_down)
+{
+	if (button->is_down != is_down)
+	{
+		++button->transitions;
+		button->is_down = is_down;
+	}
+}
+
+internal Input_Button *
+headless_find_button(Keyboard_Input *keyboard, Mouse_Input *mouse, char *name)
+{
+	struct { char *name; Input_Button *button; } buttons[] =
+	{
+		{ "up",        &keyboard->up        },
+		{ "right",     &keyboard->right     },
+		{ "down",      &keyboard->down      },
+		{ "left",      &keyboard->left      },
+		{ "enter",     &keyboard->enter     },
+		{ "backspace", &keyboard->backspace },
+		{ "delete",    &keyboard->del       },
+		{ "home",      &keyboard->home      },
+		{ "end",       &keyboard->end       },
+		{ "cut",       &keyboard->cut       },
+		{ "copy",      &keyboard->copy      },
+		{ "paste",     &keyboard->paste     },
+		{ "save",      &keyboard->save      },
+		{ "mouse_left",   &mouse->left   },
+		{ "mouse_right",  &mouse->right  },
+		{ "mouse_middle", &mouse->middle },
+	};
+	for (u32 i = 0; i < array_count(buttons); ++i)
+	{
+		if (!strcmp(buttons[i].name, name))
+			return(buttons[i].button);
+	}
+	return(0);
+}
+
+internal inline void
+reset_button(Input_Button *button)
+{
+	button->transitions = 0;
+}
+
+internal inline void
+reset_keyboard_input(Keyboard_Input *input)
+{
+	reset_button(&input->up);
+	reset_button(&input->right);
+	reset_button(&input->down);
+	reset_button(&input->left);
+	reset_button(&input->enter);
+	reset_button(&input->backspace);
+	reset_button(&input->del);
+	reset_button(&input->home);
+	reset_button(&input->end);
+	reset_button(&input->cut);
+	reset_button(&input->copy);
+	reset_button(&input->paste);
+	reset_button(&input->save);
+	input->input_buffer.length = 0;
+}
+
+internal inline void
+reset_mouse_input(Mouse_Input *input)
+{
+	reset_button(&input->left);
+	reset_button(&input->right);
+	reset_button(&input->middle);
+}
+
+internal inline s64
+current_microseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((s64)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+struct Headless_Frames
+{
+	u64 count;
+	s64 total;
+	s64 fastest;
+	s64 slowest;
+	u64 pixels; // presented, of what the frames changed
+	u64 canvas_pixels;
+};
+
+int
+main(int argument_count, char **arguments)
+{
+	FILE *script = stdin;
+	if (argument_count > 1)
+	{
+		script = fopen(arguments[1], "rb");
+		if (!script)
+		{
+			fprintf(stderr, "ninecalc_headless: can't open %s\n", arguments[1]);
+			return(1);
+		}
+	}
+
+	// as much as the Windows layer gives it
+	Memory_Arena memory = headless_allocate_memory(mebibytes(5));
+	Memory_Arena scratch = headless_allocate_memory(mebibytes(16));
+	if (!memory.data || !scratch.data)
+	{
+		fprintf(stderr, "ninecalc_headless: out of memory\n");
+		return(1);
+	}
+
+	Platform headless_platform = {};
+	headless_platform.load_font          = headless_load_font;
+	headless_platform.push_to_clipboard  = headless_push_to_clipboard;
+	headless_platform.pop_from_clipboard = headless_pop_from_clipboard;
+
+	Canvas canvas = {};
+	headless_resize_canvas(&canvas, 480, 360);
+
+	Keyboard_Input keyboard = {};
+	Mouse_Input    mouse    = {};
+	Time_Input     time     = {};
+	s64 frame_microseconds = 1000000 / 30;
+	time.delta = frame_microseconds;
+
+	Headless_Frames frames = {};
+	frames.fastest = 0x7FFFFFFFFFFFFFFF;
+	printf("frame\tmicroseconds\tpixels\n");
+
+	bool32 succeeded = true;
+	u64 line_number = 0;
+	static char line[65536];
+	// the first frame sets the state up, input can only go in after it
+	bool32 first_frame = true;
+	while (succeeded)
+	{
+		u64 frame_count = 0;
+		if (first_frame)
+		{
+			first_frame = false;
+			frame_count = 1;
+		}
+		else
+		{
+			if (!fgets(line, sizeof(line), script))
+				break;
+			++line_number;
+
+			u64 length = strlen(line);
+			while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+				line[--length] = 0;
+
+			char *command = line;
+			while (*command == ' ' || *command == '\t')
+				++command;
+			char *argument = command;
+			while (*argument && *argument != ' ' && *argument != '\t')
+				++argument;
+			if (*argument)
+				*argument++ = 0;
+
+			s32 x = 0, y = 0;
+			if (!*command || *command == '#')
+				continue;
+			else if (!strcmp(command, "frame"))
+			{
+				frame_count = *argument? strtoull(argument, 0, 10) : 1;
+			}
+			else if (!strcmp(command, "type"))
+			{
+				scratch.used = 0;
+				UTF32_String text = make_string_from_utf8(&scratch, (u8*)argument, strlen(argument));
+				for (u64 i = 0; i < text.length; ++i)
+				{
+					if (codepoint_is_printable(text.data[i]))
+						insert_character_if_fits(&keyboard.input_buffer, text.data[i], keyboard.input_buffer.length);
+				}
+			}
+			else if (!strcmp(command, "press") || !strcmp(command, "hold") || !strcmp(command, "release"))
+			{
+				Input_Button *button = headless_find_button(&keyboard, &mouse, argument);
+				if (!button)
+				{
+					fprintf(stderr, "ninecalc_headless: line %llu: no key or button called '%s'\n", line_number, argument);
+					succeeded = false;
+				}
+				else if (!strcmp(command, "press"))
+				{
+					headless_update_button(button, true);
+					headless_update_button(button, false);
+				}
+				else
+					headless_update_button(button, !strcmp(command, "hold"));
+			}
+			else if (!strcmp(command, "mouse") && sscanf(argument, "%d %d", &x, &y) == 2)
+			{
+				mouse.x = (s16)x;
+				mouse.y = (s16)y;
+			}
+			else if (!strcmp(command, "size") && sscanf(argument, "%d %d", &x, &y) == 2 && x > 0 && y > 0)
+			{
+				headless_resize_canvas(&canvas, x, y);
+			}
+			else if (!strcmp(command, "clipboard"))
+			{
+				scratch.used = 0;
+				UTF32_String text = make_string_from_utf8(&scratch, (u8*)argument, strlen(argument));
+				u64 length = 0;
+				for (u64 i = 0; i < text.length; ++i)
+				{
+					if (text.data[i] == '\\' && i + 1 < text.length && text.data[i + 1] == 'n')
+					{
+						text.data[length++] = '\n';
+						++i;
+					}
+					else
+						text.data[length++] = text.data[i];
+				}
+				text.length = length;
+				headless_push_to_clipboard(text);
+			}
+			else if (!strcmp(command, "dump") && *argument)
+			{
+				if (!headless_dump_canvas(&canvas, argument))
+				{
+					fprintf(stderr, "ninecalc_headless: line %llu: can't write %s\n", line_number, argument);
+					succeeded = false;
+				}
+			}
+#if PROFILE
+			else if (!strcmp(command, "trace") && *argument)
+			{
+				char *count = argument;
+				while (*count && *count != ' ' && *count != '\t')
+					++count;
+				if (*count)
+					*count++ = 0;
+				u64 trace_frames = *count? strtoull(count, 0, 10) : PROFILE_FRAME_COUNT;
+
+				scratch.used = 0;
+				UTF8_String trace = format_profile_trace(&scratch, trace_frames);
+				FILE *file = fopen(argument, "wb");
+				if (!file || fwrite(trace.data, 1, trace.length, file) != trace.length || fclose(file))
+				{
+					fprintf(stderr, "ninecalc_headless: line %llu: can't write %s\n", line_number, argument);
+					succeeded = false;
+				}
+			}
+#endif
+			else
+			{
+				fprintf(stderr, "ninecalc_headless: line %llu: can't make sense of '%s'\n", line_number, command);
+				succeeded = false;
+			}
+		}
+
+		for (u64 i = 0; i < frame_count; ++i)
+		{
+			s64 start = current_microseconds();
+			update_and_render(&memory, &headless_platform, &canvas, &time, &keyboard, &mouse);
+			s64 elapsed = current_microseconds() - start;
+
+			// what a window would have to present
+			u64 pixels = 0;
+			for (u32 j = 0; j < canvas.dirty_rect_count; ++j)
+			{
+				Rect dirty = canvas.dirty_rects[j];
+				pixels += (u64)(dirty.max_x - dirty.min_x) * (dirty.max_y - dirty.min_y);
+			}
+
+			printf("%llu\t%lld\t%llu\n", frames.count, elapsed, pixels);
+			++frames.count;
+			frames.pixels        += pixels;
+			frames.canvas_pixels += (u64)canvas.width * canvas.height;
+			frames.total  += elapsed;
+			frames.fastest = minimum(frames.fastest, elapsed);
+			frames.slowest = maximum(frames.slowest, elapsed);
+
+			reset_keyboard_input(&keyboard);
+			reset_mouse_input(&mouse);
+
+			// simulated time, so the same script always sees the same clock
+			time.elapsed += frame_microseconds;
+			time.delta    = frame_microseconds;
+		}
+	}
+
+	if (frames.count)
+	{
+		fprintf(stderr, "%llu frames, %.1f us on average, %lld fastest, %lld slowest, %.1f%% of the pixels presented\n",
+			frames.count, (double)frames.total / frames.count, frames.fastest, frames.slowest,
+			100.0 * frames.pixels / frames.canvas_pixels);
+	}
+	return(succeeded? 0 : 1);
+}
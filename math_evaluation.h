@@ -15,10 +15,35 @@ enum class Token_Type
 	End
 };
 
+typedef u32 Atom;
+enum : Atom
+{
+	// interned by make_atom_table, in this order
+	Atom_Prev,
+	Atom_Sum,
+
+	Atom_None = 0xFFFFFFFF
+};
+
+struct Atom_Table
+{
+	// every distinct identifier gets the index of its name as its atom
+	Memory_Arena *arena;
+	UTF8_String  *names;
+	u64          *hashes;
+	Atom         *index; // open addressing over the names, twice their capacity
+	u32          count;
+	u32          capacity;
+};
+
 struct Token
 {
 	Token_Type type;
-	UTF32_String text;
+	u32  symbol; // the first byte, which is all operators and parentheses are told apart by
+	u64  offset; // where the token is in the expression, in bytes
+	u64  length;
+	Atom atom;   // for variables
+	f64  value;  // for numbers, parsed once here
 };
 
 struct Token_List
@@ -58,36 +83,85 @@ struct Result
 
 struct Context
 {
-	UTF32_String *variables;
-	f64        *values;
-	u64        count;
-	u64        capacity;
+	// open addressing with linear probing, grown into the arena when 3/4 full
+	Memory_Arena *arena;
+	Atom_Table   *atoms; // interns the identifiers of expressions evaluated in this context
+	Atom         *variables; // Atom_None where empty
+	f64          *values;
+	u64          count;
+	u64          capacity; // a power of two
+
+	Result operator[](Atom);
+};
+
+enum class Opcode : u8
+{
+	Constant,        // push constants[operand]
+	Load,            // push the value of slots[operand]
+	Store,           // assign the top of the stack to slots[operand], if valid
+	Invalid,         // push an invalid result
+	Skip_If_Invalid, // jump to operand if the top of the stack is invalid
+
+	// unary, on the top of the stack
+	Negate,
+	Factorial,
+	Invalidate,
+
+	// binary, pop the right operand into the left one, unless the instruction says where else it is
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Power,
+	Nothing, // a binary operator without meaning (e.g. '!'), evaluates to 0
+};
+
+enum class Operand : u16
+{
+	Stack,    // popped
+	Constant, // constants[operand]
+	Slot,     // the value of slots[operand]
+};
+
+struct Instruction
+{
+	Opcode  opcode;
+	Opcode  fallback; // for binary operators, applied to the left operand if the right one is invalid
+	Operand right;    // for binary operators
+	u32     operand;
+};
 
-	Result operator[](UTF32_String);
+struct Program
+{
+	Instruction  *code;
+	f64          *constants;
+	Atom         *slots;
+
+	u32 code_count;
+	u32 constant_count;
+	u32 slot_count;
+	u32 stack_size;
 };
 
-internal Token_List tokenize_expression(Memory_Arena*, UTF32_String);
+internal Atom_Table make_atom_table(Memory_Arena*, u32);
+internal Atom intern(Atom_Table*, UTF8_String);
+
+internal Token_List tokenize_expression(Memory_Arena*, UTF8_String, Atom_Table*);
 internal AST *parse_tokens(Memory_Arena*, Token_List);
 internal Result evaluate_tree(AST*, Context*);
-internal Result evaluate_expression(Memory_Arena*, UTF32_String, Context*);
+internal Program compile_tree(Memory_Arena*, AST*, Token_List);
+internal Result run_program(Memory_Arena*, Program*, Context*);
+internal Result evaluate_expression(Memory_Arena*, UTF8_String, Context*);
 
-internal Context make_context(Memory_Arena *, u64);
-internal void add_or_update_variable(Context*, UTF32_String, f64);
+internal Context make_context(Memory_Arena *, Atom_Table*, u64);
+internal Result lookup_variable(Context*, Atom);
+internal void add_or_update_variable(Context*, Atom, f64);
 
 //--------------------------------------------------
 
-Result Context::operator[](UTF32_String variable)
+Result Context::operator[](Atom variable)
 {
-	Result result = {};
-	for (u64 i = 0; i < this->count; ++i)
-	{
-		if (strings_are_equal(this->variables[i], variable))
-		{
-			result = { true, this->values[i] };
-			break;
-		}
-	}
-	return(result);
+	return(lookup_variable(this, variable));
 }
 
 Token &Token_List::operator[](u64 index)
@@ -98,112 +172,228 @@ Token &Token_List::operator[](u64 index)
 		return(this->data[this->count - 1]);
 }
 
-internal bool32 is_whitespace(u32 codepoint) { return(codepoint == ' ' || codepoint == '\n' || codepoint == '\t' ); }
+internal Atom_Table
+make_atom_table(Memory_Arena *arena, u32 capacity)
+{
+	Atom_Table table = {};
+	table.arena    = arena;
+	table.capacity = (u32)maximum(capacity, 8);
+	table.names    = allocate_array(arena, UTF8_String, table.capacity);
+	table.hashes   = allocate_array(arena, u64, table.capacity);
+	table.index    = allocate_array(arena, Atom, 2 * table.capacity);
+	for (u32 i = 0; i < 2 * table.capacity; ++i)
+		table.index[i] = Atom_None;
 
-internal void
-consume_whitespace(UTF32_String *input)
+	Atom prev = intern(&table, UTF8_String{ (u8*)"prev", 4 });
+	Atom sum  = intern(&table, UTF8_String{ (u8*)"sum", 3 });
+	assert(prev == Atom_Prev && sum == Atom_Sum);
+	return(table);
+}
+
+internal u32
+find_atom_index(Atom_Table *table, UTF8_String name, u64 hash)
 {
-	while (input->length && is_whitespace(*(input->data)))
+	u32 mask = 2 * table->capacity - 1;
+	u32 i = (u32)hash & mask;
+	for (Atom atom = table->index[i]; atom != Atom_None; atom = table->index[i])
 	{
-		++(input->data);
-		--(input->length);
+		if (table->hashes[atom] == hash && strings_are_equal(table->names[atom], name))
+			break;
+		i = (i + 1) & mask;
 	}
+	return(i);
 }
 
-internal bool32 is_number(u32 codepoint) { return(codepoint >= '0' && codepoint <= '9'); }
-internal bool32 is_parenthesis(u32 codepoint) { return(codepoint == '(' || codepoint == ')'); }
-internal bool32
-is_letter(u32 codepoint)
+internal Atom
+intern(Atom_Table *table, UTF8_String name)
 {
-	return((codepoint >= 'A' && codepoint <= 'Z') ||
-		   (codepoint >= 'a' && codepoint <= 'z'));
+	u64 hash = hash_string(name);
+	u32 i = find_atom_index(table, name, hash);
+	if (table->index[i] == Atom_None)
+	{
+		if (table->count == table->capacity)
+		{
+			Atom_Table grown = *table;
+			grown.capacity = 2 * table->capacity;
+			grown.names    = allocate_array(table->arena, UTF8_String, grown.capacity);
+			grown.hashes   = allocate_array(table->arena, u64, grown.capacity);
+			grown.index    = allocate_array(table->arena, Atom, 2 * grown.capacity);
+			for (u32 j = 0; j < 2 * grown.capacity; ++j)
+				grown.index[j] = Atom_None;
+			for (Atom atom = 0; atom < table->count; ++atom)
+			{
+				grown.names[atom]  = table->names[atom];
+				grown.hashes[atom] = table->hashes[atom];
+				grown.index[find_atom_index(&grown, table->names[atom], table->hashes[atom])] = atom;
+			}
+			*table = grown;
+			i = find_atom_index(table, name, hash);
+		}
+
+		// tokens are views into text that changes, so the table keeps its own copy
+		UTF8_String copy;
+		copy.data = allocate_array(table->arena, u8, name.length);
+		copy.length = name.length;
+		for (u64 j = 0; j < name.length; ++j)
+			copy.data[j] = name.data[j];
+
+		Atom atom = table->count++;
+		table->names[atom]  = copy;
+		table->hashes[atom] = hash;
+		table->index[i]     = atom;
+	}
+	return(table->index[i]);
 }
-internal bool32
-starts_with_operator(UTF32_String input)
+
+enum Char_Class : u8
+{
+	Class_None        = 0,
+	Class_Digit       = 1 << 0,
+	Class_Letter      = 1 << 1,
+	Class_Underscore  = 1 << 2,
+	Class_Point       = 1 << 3,
+	Class_Whitespace  = 1 << 4,
+	Class_Operator    = 1 << 5,
+	Class_Parenthesis = 1 << 6,
+
+	Class_Number   = Class_Digit | Class_Underscore | Class_Point,
+	Class_Variable = Class_Letter | Class_Digit | Class_Underscore,
+};
+
+#define W_ Class_Whitespace
+#define D_ Class_Digit
+#define L_ Class_Letter
+#define U_ Class_Underscore
+#define P_ Class_Point
+#define O_ Class_Operator
+#define B_ Class_Parenthesis
+global const u8 ascii_classes[128] =
 {
-	return(input[0] == '+' ||
-		   input[0] == '-' ||
-		   input[0] == '*' ||
-		   input[0] == '/' ||
-		   input[0] == '^' ||
-		   input[0] == '!' ||
-		   input[0] == ':');
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  W_, W_, 0,  0,  0,  0,  0,
+	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	W_, O_, 0,  0,  0,  0,  0,  0,  B_, B_, O_, O_, 0,  O_, P_, O_, //  !"#$%&'()*+,-./
+	D_, D_, D_, D_, D_, D_, D_, D_, D_, D_, O_, 0,  0,  0,  0,  0,  // 0123456789:;<=>?
+	0,  L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_,  // @ABCDEFGHIJKLMNO
+	L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, 0,  0,  0,  O_, U_, // PQRSTUVWXYZ[\]^_
+	0,  L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_,  // `abcdefghijklmno
+	L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, 0,  0,  0,  0,  0,  // pqrstuvwxyz{|}~
+};
+#undef W_
+#undef D_
+#undef L_
+#undef U_
+#undef P_
+#undef O_
+#undef B_
+
+internal inline u8
+classify(u32 codepoint)
+{
+	// nothing outside ASCII is part of the syntax (yet), so it all lands in invalid tokens.
+	// That goes for every byte of a UTF-8 sequence too, which is why text never needs decoding here.
+	return(codepoint < 128? ascii_classes[codepoint] : (u8)Class_None);
 }
 
-internal bool32 is_valid_number(u32 codepoint)   { return(is_number(codepoint) || codepoint == '_' || codepoint == '.'); }
-internal bool32 is_valid_variable(u32 codepoint) { return(is_letter(codepoint) || is_number(codepoint) || codepoint == '_'); }
+internal bool32 is_whitespace(u32 codepoint)  { return(classify(codepoint) & Class_Whitespace); }
+internal bool32 is_number(u32 codepoint)      { return(classify(codepoint) & Class_Digit); }
+internal bool32 is_parenthesis(u32 codepoint) { return(classify(codepoint) & Class_Parenthesis); }
+internal bool32 is_letter(u32 codepoint)      { return(classify(codepoint) & Class_Letter); }
+internal bool32 starts_with_operator(UTF8_String input) { return(classify(input[0]) & Class_Operator); }
+
+internal bool32 is_valid_number(u32 codepoint)   { return(classify(codepoint) & Class_Number); }
+internal bool32 is_valid_variable(u32 codepoint) { return(classify(codepoint) & Class_Variable); }
+
+// How many bytes from the start of the string are all in one of the classes.
+internal inline u64
+count_run(UTF8_String input, u8 classes)
+{
+	u64 i = 0;
+	while (i < input.length && (classify(input.data[i]) & classes))
+		++i;
+	return(i);
+}
+
+internal void
+consume_whitespace(UTF8_String *input)
+{
+	*input = substring(*input, count_run(*input, Class_Whitespace));
+}
 
 internal Token
-consume_number_token(UTF32_String *input)
+consume_number_token(UTF8_String *input)
 {
 	Token token = { Token_Type::Number };
 
-	bool32 has_decimal = false;
-	u64 i = 0;
-	while (i < input->length && is_valid_number(input->data[i]))
+	u64 i = count_run(*input, Class_Number);
+
+	// an exponent only if digits follow, otherwise the 'e' starts a variable
+	if (i < input->length && (input->data[i] == 'e' || input->data[i] == 'E'))
 	{
-		u32 codepoint = input->data[i];
-		if (codepoint == '.')
+		u64 j = i + 1;
+		if (j < input->length && (input->data[j] == '+' || input->data[j] == '-'))
+			++j;
+		if (j < input->length && is_number(input->data[j]))
 		{
-			if (has_decimal)
-			{
-				token.type = Token_Type::Invalid;
-			}
-			has_decimal = true;
+			i = j;
+			while (i < input->length && (is_number(input->data[i]) || input->data[i] == '_'))
+				++i;
 		}
-		++i;
 	}
-	token.text = substring(*input, 0, i);
+	token.length = i;
+
+	// a second point, or no digits at all
+	if (!parse_float(substring(*input, 0, i), &token.value))
+		token.type = Token_Type::Invalid;
 	*input = substring(*input, i);
 
 	return token;
 }
 
 internal Token
-consume_variable_token(UTF32_String *input)
+consume_variable_token(UTF8_String *input)
 {
 	Token token = { Token_Type::Variable };
 
-	u64 i = 0;
-	while (i < input->length && is_valid_variable(input->data[i]))
-		++i;
-	token.text = substring(*input, 0, i);
-	*input = substring(*input, i);
+	token.length = count_run(*input, Class_Variable);
+	*input = substring(*input, token.length);
 
 	return token;
 }
 
 internal Token 
-consume_operator_token(UTF32_String *input)
+consume_operator_token(UTF8_String *input)
 {
     Token token = { Token_Type::Operator };
     // for now, all operators are one character, so...
-	token.text = substring(*input, 0, 1);
+	token.symbol = (*input)[0];
+	token.length = 1;
 	*input = substring(*input, 1);
 
 	return token;
 }
 
 internal Token 
-consume_parenthesis_token(UTF32_String *input)
+consume_parenthesis_token(UTF8_String *input)
 {
     Token token = { Token_Type::Parenthesis };
 
-	token.text = substring(*input, 0, 1);
+	token.symbol = (*input)[0];
+	token.length = 1;
 	*input = substring(*input, 1);
 
 	return token;
 }
 
 internal Token 
-consume_invalid_token(UTF32_String *input)
+consume_invalid_token(UTF8_String *input)
 {
 	Token token = { Token_Type::Invalid };
 
 	u64 i = 0;
 	while (i < input->length && (*input)[i] != ' ')
 		++i;
-	token.text = substring(*input, 0, i);
+	token.symbol = (*input)[0];
+	token.length = i;
 	*input = substring(*input, i);
 
 	return(token);
@@ -218,26 +408,30 @@ make_end_token(Memory_Arena *arena)
 }
 
 internal Token_List
-tokenize_expression(Memory_Arena *arena, UTF32_String input)
+tokenize_expression(Memory_Arena *arena, UTF8_String expression, Atom_Table *atoms)
 {
 	Token_List tokens = {};
 	tokens.data = cast_tail(arena, Token);
 
+	UTF8_String input = expression;
 	consume_whitespace(&input);
 	while (input.length)
 	{
 		Token *token = allocate_struct(arena, Token);
+		u64 offset = input.data - expression.data;
 
-		if (is_number(input[0]) || input[0] == '.')
+		u8 first = classify(input[0]);
+		if (first & (Class_Digit | Class_Point))
 			*token = consume_number_token(&input);
-		else if (is_letter(input[0]) || input[0] == '_')
+		else if (first & (Class_Letter | Class_Underscore))
 			*token = consume_variable_token(&input);
-		else if (starts_with_operator(input))
+		else if (first & Class_Operator)
 			*token = consume_operator_token(&input);
-		else if (is_parenthesis(input[0]))
+		else if (first & Class_Parenthesis)
 			*token = consume_parenthesis_token(&input);
 		else
 			*token = consume_invalid_token(&input);
+		token->offset = offset;
 
 		++tokens.count;
 
@@ -246,31 +440,34 @@ tokenize_expression(Memory_Arena *arena, UTF32_String input)
 	make_end_token(arena);
 	++tokens.count;
 
+	// only once the tokens are all in place, as the atoms may take from the same arena
+	for (u64 i = 0; i < tokens.count; ++i)
+	{
+		Token *token = tokens.data + i;
+		if (token->type == Token_Type::Variable)
+			token->atom = intern(atoms, substring(expression, token->offset, token->length));
+	}
+
 	return(tokens);
 }
 
 bool32 is_number_or_variable(Token token) { return(token.type == Token_Type::Number || token.type == Token_Type::Variable); }
-bool32 is_open_parenthesis(Token token) { return(token.type == Token_Type::Parenthesis && token.text[0] == '('); }
+bool32 is_open_parenthesis(Token token) { return(token.type == Token_Type::Parenthesis && token.symbol == '('); }
 bool32 is_prefix_operator(Token token)
 {
 	// only '-' as a prefix operator so far
-	return(token.type == Token_Type::Operator && token.text[0] == '-');
+	return(token.type == Token_Type::Operator && token.symbol == '-');
 }
 bool32 is_suffix_operator(Token token)
 {
 	// only '!' as a sufix operator so far
-	return(token.type == Token_Type::Operator && token.text[0] == '!');
+	return(token.type == Token_Type::Operator && token.symbol == '!');
 }
 bool32 is_end_of_expression(Token token)
 {
 	return(token.type == Token_Type::End ||
 		   (token.type == Token_Type::Parenthesis &&
-		   	token.text[0] == ')'));
-}
-
-Token_List tokens_from(Token_List list, u64 offset)
-{
-	return(Token_List{ list.data + offset, list.count - offset });
+		   	token.symbol == ')'));
 }
 
 AST *make_node(Memory_Arena *arena)
@@ -298,7 +495,7 @@ AST *make_operator_node(Memory_Arena *arena, Token token, AST *left, AST *right)
 {
 	AST *node = allocate_struct(arena, AST);
 	*node = { token, left->consumed + right->consumed + 1, left, right };
-	switch(token.text[0])
+	switch(token.symbol)
 	{
 		case '+': node->precedence = Precedence::Addition;       break;
 		case '-': node->precedence = Precedence::Subtraction;    break;
@@ -309,110 +506,198 @@ AST *make_operator_node(Memory_Arena *arena, Token token, AST *left, AST *right)
 	return(node);
 }
 
-AST *parse_prefixed_term(Memory_Arena *arena, Token_List tokens)
+internal u32
+binding_power(Token token)
 {
-	AST *term = 0;
-	if (is_number_or_variable(tokens[1]))
-		term = make_term_node(arena, tokens[1]);
-	else if (is_open_parenthesis(tokens[1]))
-	{
-		term = parse_tokens(arena, tokens_from(tokens, 2));
-		term->consumed += 2;
-		term->precedence = Precedence::Parenthesis;
-	}
-
-	AST* prefixed_term;
-	if (term)
+	// every binary operator groups to the left, so a chain only binds tighter to the right
+	switch (token.symbol)
 	{
-		prefixed_term = make_operator_node(arena, tokens[0], term);
-		prefixed_term->precedence = Precedence::Annex;
+		case '+': case '-': return(2);
+		case '*': case '/': return(3);
+		case '^':           return(4);
+		default:            return(1); // ':', and '!' after its postfix use
 	}
-	else
-	{
-		prefixed_term = make_term_node(arena, tokens[0]);
-		prefixed_term->invalid = true;
-	}
-	return(prefixed_term);
 }
 
+enum class Pending_Kind
+{
+	Binary,
+	Prefix,
+	Parenthesis
+};
+
+struct Pending_Operator
+{
+	Pending_Kind kind;
+	Token        token;
+	u32          binding_power;
+};
+
 AST *parse_tokens(Memory_Arena *arena, Token_List tokens)
 {
-	AST *node = 0;
-	if (tokens.count)
+	// operator precedence (Pratt) parsing, with explicit stacks instead of recursion:
+	// operands wait on one stack for the operators and parentheses still open on the other
+	AST              **operands  = allocate_array(arena, AST*, tokens.count + 1);
+	Pending_Operator *operators = allocate_array(arena, Pending_Operator, tokens.count + 1);
+	u32 operand_count = 0, operator_count = 0;
+	u32 open_parentheses = 0;
+
+	u64 i = 0;
+	for (;;)
 	{
-		Token token = tokens[0];
+		// an operand: a term, or an opening parenthesis or prefix to wait on for one
+		Token token = tokens[i];
+		if (is_open_parenthesis(token))
+		{
+			operators[operator_count++] = { Pending_Kind::Parenthesis, token };
+			++open_parentheses;
+			++i;
+			continue;
+		}
+		if (is_prefix_operator(token) && (is_number_or_variable(tokens[i + 1]) || is_open_parenthesis(tokens[i + 1])))
+		{
+			operators[operator_count++] = { Pending_Kind::Prefix, token };
+			++i;
+			continue;
+		}
 
+		AST *operand;
 		if (is_number_or_variable(token))
-			node = make_term_node(arena, token);
-		else if (is_open_parenthesis(token))
 		{
-			node = parse_tokens(arena, tokens_from(tokens, 1));
-			node->consumed += 2;
-			node->precedence = Precedence::Parenthesis;
+			operand = make_term_node(arena, token);
+			++i;
 		}
 		else if (is_prefix_operator(token))
-			node = parse_prefixed_term(arena, tokens);
-		else
 		{
-			if (!node)
-				node = make_node(arena);
-			node->invalid = true;
+			// a prefix with nothing to apply to
+			operand = make_term_node(arena, token);
+			operand->invalid = true;
+			++i;
 		}
-
-		token = tokens[node->consumed];
-		if (is_suffix_operator(token))
+		else
 		{
-			AST *left_node = node;
-			node = make_operator_node(arena, token, left_node);
-			node->precedence = Precedence::Annex;
-			token = tokens[node->consumed];
+			// missing, the token is looked at again as an operator
+			operand = make_node(arena);
+			operand->invalid = true;
 		}
 
-		if (token.type == Token_Type::Operator)
+		// then whatever closes around it, until the next binary operator
+		bool32 is_done = false;
+		for (;;)
 		{
-			AST *left_node = node;
-			node = make_operator_node(arena, token, left_node,
-				parse_tokens(arena, tokens_from(tokens, left_node->consumed + 1)));
-			// rotate tree to comply with order of operations
-			if (node->right->token.type == Token_Type::Operator &&
-				node->right->precedence <= node->precedence)
+			if (operator_count && operators[operator_count - 1].kind == Pending_Kind::Prefix)
+			{
+				operand = make_operator_node(arena, operators[--operator_count].token, operand);
+				operand->precedence = Precedence::Annex;
+			}
+			if (is_suffix_operator(tokens[i]))
+			{
+				operand = make_operator_node(arena, tokens[i++], operand);
+				operand->precedence = Precedence::Annex;
+			}
+
+			token = tokens[i];
+			if (token.type == Token_Type::Operator)
+			{
+				u32 power = binding_power(token);
+				while (operator_count && operators[operator_count - 1].kind == Pending_Kind::Binary &&
+					operators[operator_count - 1].binding_power >= power)
+				{
+					AST *left = operands[--operand_count];
+					operand = make_operator_node(arena, operators[--operator_count].token, left, operand);
+				}
+				operands[operand_count++] = operand;
+				operators[operator_count++] = { Pending_Kind::Binary, token, power };
+				++i;
+				break;
+			}
+
+			// anything else ends the innermost parenthesis (as if it were the ')'), or the whole expression
+			if (token.type != Token_Type::End && !is_end_of_expression(token))
+				operand->invalid = true;
+			while (operator_count && operators[operator_count - 1].kind == Pending_Kind::Binary)
+			{
+				AST *left = operands[--operand_count];
+				operand = make_operator_node(arena, operators[--operator_count].token, left, operand);
+			}
+			if (!open_parentheses)
 			{
-				u32 consumed = node->consumed;
-				AST *node_right_left = node->right->left;
-				node->right->left = node;
-				node = node->right;
-				node->left->right = node_right_left;
-				node->consumed = consumed;
+				is_done = true;
+				break;
 			}
+			--operator_count;
+			--open_parentheses;
+			operand->consumed += 2;
+			operand->precedence = Precedence::Parenthesis;
+			++i;
 		}
-		else if (!is_end_of_expression(token))
+		if (is_done)
 		{
-			if (!node)
-				node = make_node(arena);
-			node->invalid = true;
+			operands[operand_count++] = operand;
+			break;
 		}
 	}
-	return(node);
+
+	return(operands[0]);
 }
 
+// n! stays finite up to 1754! with an 80-bit long double, and up to 170! with a 64-bit one
+#define F64_FACTORIAL_COUNT (LDBL_MAX_EXP > 1024? 1755 : 171)
+
+struct Factorial_Table
+{
+	f64 values[F64_FACTORIAL_COUNT];
+
+	constexpr Factorial_Table() : values()
+	{
+		// the same running product the loop used to compute on every call
+		values[0] = 1;
+		for (s32 i = 1; i < F64_FACTORIAL_COUNT; ++i)
+			values[i] = values[i - 1] * i;
+	}
+};
+global constexpr Factorial_Table factorials;
+
 internal Result
 factorial(f64 input)
 {
+	// integers come from the table (or overflow right away), anything between them is Γ(x + 1)
 	Result result = {};
-	s64 number = (s64)input;
-	if (number >= 0)
+	if (std::floor(input) == input)
 	{
-		if (number < 2)
-			result = { true, 1 };
-		else
+		if (input >= 0)
+			result = { true, input < F64_FACTORIAL_COUNT? factorials.values[(s32)input] : HUGE_VALL };
+	}
+	else if (input == input)
+		result = { true, std::tgamma(input + 1) };
+	return(result);
+}
+
+internal f64
+exponentiate(f64 base, f64 exponent)
+{
+	// small integer exponents by squaring, a few multiplies instead of a pow call.
+	// Every multiply rounds, so this stops at 16, where it is off by 10 ulp at most.
+	if (std::floor(exponent) == exponent && exponent >= -16 && exponent <= 16)
+	{
+		u32 bits = (u32)(exponent < 0? -exponent : exponent);
+		f64 result = 1;
+		f64 square = base;
+		while (bits)
 		{
-			f64 value = 1;
-			for (s64 i = 2; i <= number; ++i)
-				value *= i;
-			result = { true, value };
+			if (bits & 1)
+				result *= square;
+			square *= square;
+			bits >>= 1;
 		}
+		if (exponent >= 0)
+			return(result);
+		// 1/x^n loses nothing more unless x^n already overflowed or went subnormal
+		if (std::isnormal(result))
+			return(1 / result);
 	}
-	return(result);
+	// std:: for the long double overload, plain pow is the double one
+	return(std::pow(base, exponent));
 }
 
 internal Result
@@ -423,19 +708,19 @@ evaluate_tree(AST *tree, Context *context)
 	{
 		Token token = tree->token;
 		if (token.type == Token_Type::Number)
-			result = { true, parse_float(token.text) };
+			result = { true, token.value };
 		else if (token.type == Token_Type::Variable)
-			result = (*context)[token.text];
+			result = (*context)[token.atom];
 		else if (token.type == Token_Type::Operator)
 		{
-			if (token.text[0] == ':')
+			if (token.symbol == ':')
 			{
 				Token left_token = tree->left->token;
 				if (left_token.type == Token_Type::Variable)
 				{
 					result = evaluate_tree(tree->right, context);
 					if (result.valid)
-						add_or_update_variable(context, left_token.text, result.value);
+						add_or_update_variable(context, left_token.atom, result.value);
 				}
 			}
 			else
@@ -446,25 +731,25 @@ evaluate_tree(AST *tree, Context *context)
 					Result right_result = evaluate_tree(tree->right, context);
 					if (right_result.valid)
 					{
-						if (token.text[0] == '+')
+						if (token.symbol == '+')
 							result.value = left_result.value + right_result.value;
-						else if (token.text[0] == '-')
+						else if (token.symbol == '-')
 							result.value = left_result.value - right_result.value;
-						else if (token.text[0] == '*')
+						else if (token.symbol == '*')
 							result.value = left_result.value * right_result.value;
-						else if (token.text[0] == '/')
+						else if (token.symbol == '/')
 							result.value = left_result.value / right_result.value;
-						else if (token.text[0] == '^')
-							result.value = pow(left_result.value, right_result.value);
+						else if (token.symbol == '^')
+							result.value = exponentiate(left_result.value, right_result.value);
 						result.valid = true;
 					}
 					else
 					{
 						if (tree->precedence >= Precedence::Annex)
 						{
-							if (token.text[0] == '-') 
+							if (token.symbol == '-') 
 								result = { true, -left_result.value };
-							else if (token.text[0] == '!')
+							else if (token.symbol == '!')
 								result = factorial(left_result.value);
 						}
 					}
@@ -475,41 +760,358 @@ evaluate_tree(AST *tree, Context *context)
 	return(result);
 }
 
-internal Result
-evaluate_expression(Memory_Arena *arena, UTF32_String expression, Context *context)
+internal u32
+emit_instruction(Program *program, Opcode opcode, u32 operand = 0, Opcode fallback = Opcode::Invalidate,
+	Operand right = Operand::Stack)
 {
-	Token_List tokens = tokenize_expression(arena, expression);
-	AST *tree = parse_tokens(arena, tokens);
-	Result result = evaluate_tree(tree, context);
-	return(result);
+	u32 index = program->code_count++;
+	program->code[index] = { opcode, fallback, right, operand };
+	return(index);
+}
+
+internal u32
+find_or_add_slot(Program *program, Atom atom)
+{
+	for (u32 i = 0; i < program->slot_count; ++i)
+	{
+		if (program->slots[i] == atom)
+			return(i);
+	}
+	program->slots[program->slot_count] = atom;
+	return(program->slot_count++);
 }
 
-void add_or_update_variable(Context *context, UTF32_String variable, f64 value)
+struct Compile_Frame
+{
+	AST *node;
+	u32 depth; // of the node's result on the stack
+	u32 stage; // how many of its children are compiled
+	u32 skip;
+};
+
+internal void
+compile_nodes(Program *program, AST *tree, Compile_Frame *frames)
 {
-	bool32 existed = false;
-	for (u64 i = 0; i < context->count; ++i)
+	// post-order, with the nodes still being compiled on an explicit stack rather than the native one
+	u32 frame_count = 0;
+	frames[frame_count++] = { tree, 0 };
+	while (frame_count)
 	{
-		if (strings_are_equal(context->variables[i], variable))
+		Compile_Frame *frame = frames + frame_count - 1;
+		AST *node = frame->node;
+		program->stack_size = (u32)maximum(program->stack_size, frame->depth + 1);
+
+		Token token = node? node->token : Token{};
+		if (token.type == Token_Type::Number)
 		{
-			context->values[i] = value;
-			existed = true;
-			break;
+			program->constants[program->constant_count] = token.value;
+			emit_instruction(program, Opcode::Constant, program->constant_count++);
+			--frame_count;
+		}
+		else if (token.type == Token_Type::Variable)
+		{
+			emit_instruction(program, Opcode::Load, find_or_add_slot(program, token.atom));
+			--frame_count;
+		}
+		else if (token.type == Token_Type::Operator && token.symbol == ':')
+		{
+			if (!(node->left && node->left->token.type == Token_Type::Variable))
+			{
+				emit_instruction(program, Opcode::Invalid);
+				--frame_count;
+			}
+			else if (frame->stage++ == 0)
+				frames[frame_count++] = { node->right, frame->depth };
+			else
+			{
+				emit_instruction(program, Opcode::Store, find_or_add_slot(program, node->left->token.atom));
+				--frame_count;
+			}
+		}
+		else if (token.type == Token_Type::Operator)
+		{
+			if (frame->stage == 0)
+			{
+				frame->stage = 1;
+				frames[frame_count++] = { node->left, frame->depth };
+				continue;
+			}
+			// a number or variable on the right is read by the operator itself, which needs no skip,
+			// as reading it does nothing an invalid left operand would have to prevent
+			Token right_token = node->right? node->right->token : Token{};
+			Operand right = Operand::Stack;
+			u32 right_operand = 0;
+			if (right_token.type == Token_Type::Number)
+			{
+				right = Operand::Constant;
+				right_operand = program->constant_count;
+				program->constants[program->constant_count++] = right_token.value;
+			}
+			else if (right_token.type == Token_Type::Variable)
+			{
+				right = Operand::Slot;
+				right_operand = find_or_add_slot(program, right_token.atom);
+			}
+
+			if (frame->stage == 1 && right == Operand::Stack)
+			{
+				frame->stage = 2;
+				frame->skip = emit_instruction(program, Opcode::Skip_If_Invalid);
+				if (node->right)
+				{
+					frames[frame_count++] = { node->right, frame->depth + 1 };
+					continue;
+				}
+			}
+
+			// prefix and suffix operators, and parenthesized operations missing their right operand
+			Opcode unary = Opcode::Invalidate;
+			if (node->precedence >= Precedence::Annex)
+			{
+				if (token.symbol == '-')
+					unary = Opcode::Negate;
+				else if (token.symbol == '!')
+					unary = Opcode::Factorial;
+			}
+
+			if (node->right)
+			{
+				Opcode binary = Opcode::Nothing;
+				switch (token.symbol)
+				{
+					case '+': binary = Opcode::Add;      break;
+					case '-': binary = Opcode::Subtract; break;
+					case '*': binary = Opcode::Multiply; break;
+					case '/': binary = Opcode::Divide;   break;
+					case '^': binary = Opcode::Power;    break;
+				}
+				emit_instruction(program, binary, right_operand, unary, right);
+			}
+			else
+				emit_instruction(program, unary);
+
+			if (frame->stage == 2)
+				program->code[frame->skip].operand = program->code_count;
+			--frame_count;
+		}
+		else
+		{
+			emit_instruction(program, Opcode::Invalid);
+			--frame_count;
 		}
 	}
-	if (!existed)
+}
+
+internal Program
+compile_tree(Memory_Arena *arena, AST *tree, Token_List tokens)
+{
+	// every token turns into at most two instructions, plus one for each invalid node
+	Program program = {};
+	program.code      = allocate_array(arena, Instruction, 3 * tokens.count + 1);
+	program.constants = allocate_array(arena, f64, tokens.count);
+	program.slots     = allocate_array(arena, Atom, tokens.count);
+
+	// and into at most one node, plus one missing operand
+	u64 used = arena->used;
+	Compile_Frame *frames = allocate_array(arena, Compile_Frame, 2 * tokens.count + 1);
+	compile_nodes(&program, tree, frames);
+	arena->used = used;
+
+	return(program);
+}
+
+internal Result
+run_program(Memory_Arena *arena, Program *program, Context *context)
+{
+	// the top of the stack is kept in locals, the rest in memory, values and whether they're valid apart
+	u64 used = arena->used;
+	f64    *stack  = allocate_array(arena, f64, program->stack_size);
+	bool32 *valid  = allocate_array(arena, bool32, program->stack_size);
+	f64    *values = allocate_array(arena, f64, program->slot_count);
+	bool32 *known  = allocate_array(arena, bool32, program->slot_count);
+	for (u32 i = 0; i < program->slot_count; ++i)
 	{
-		assert(context->count < context->capacity);
-		context->variables[context->count] = variable;
-		context->values[context->count] = value;
-		++context->count;
+		Result value = lookup_variable(context, program->slots[i]);
+		values[i] = value.value;
+		known[i]  = value.valid;
 	}
+
+	u32 top = 0; // how many values there are, the last one being top_value
+	f64    top_value = 0;
+	bool32 top_valid = false;
+	Instruction *code = program->code;
+	for (u32 pc = 0; pc < program->code_count; ++pc)
+	{
+		Instruction instruction = code[pc];
+		f64 right = 0;
+		if (instruction.opcode >= Opcode::Add)
+		{
+			// binary operators get their right operand ready here, so the switch only does the arithmetic
+			bool32 right_valid;
+			if (instruction.right == Operand::Constant)
+			{
+				right = program->constants[instruction.operand];
+				right_valid = true;
+			}
+			else if (instruction.right == Operand::Slot)
+			{
+				right = values[instruction.operand];
+				right_valid = known[instruction.operand];
+			}
+			else
+			{
+				right = top_value;
+				right_valid = top_valid;
+				top_value = stack[--top];
+				top_valid = valid[top];
+			}
+
+			// a left operand read along with its right one may be invalid, and stays so
+			if (!top_valid)
+				continue;
+			if (!right_valid)
+				instruction.opcode = instruction.fallback;
+		}
+
+		switch (instruction.opcode)
+		{
+			case Opcode::Constant:
+			{
+				stack[top] = top_value;
+				valid[top++] = top_valid;
+				top_value = program->constants[instruction.operand];
+				top_valid = true;
+			} break;
+			case Opcode::Load:
+			{
+				stack[top] = top_value;
+				valid[top++] = top_valid;
+				top_value = values[instruction.operand];
+				top_valid = known[instruction.operand];
+			} break;
+			case Opcode::Invalid:
+			{
+				stack[top] = top_value;
+				valid[top++] = top_valid;
+				top_value = 0;
+				top_valid = false;
+			} break;
+			case Opcode::Store:
+			{
+				if (top_valid)
+				{
+					values[instruction.operand] = top_value;
+					known[instruction.operand]  = true;
+					add_or_update_variable(context, program->slots[instruction.operand], top_value);
+				}
+			} break;
+			case Opcode::Skip_If_Invalid:
+			{
+				if (!top_valid)
+					pc = instruction.operand - 1;
+			} break;
+
+			case Opcode::Negate:     top_value = -top_value; break;
+			case Opcode::Invalidate: top_valid = false; break;
+			case Opcode::Factorial:
+			{
+				Result result = factorial(top_value);
+				top_value = result.value;
+				top_valid = result.valid;
+			} break;
+
+			case Opcode::Add:      top_value = top_value + right; break;
+			case Opcode::Subtract: top_value = top_value - right; break;
+			case Opcode::Multiply: top_value = top_value * right; break;
+			case Opcode::Divide:   top_value = top_value / right; break;
+			case Opcode::Power:    top_value = exponentiate(top_value, right); break;
+			case Opcode::Nothing:  top_value = 0; break;
+		}
+	}
+
+	Result result = {};
+	if (top && top_valid)
+		result = { true, top_value };
+	arena->used = used;
+	return(result);
 }
 
-Context make_context(Memory_Arena *arena, u64 capacity)
+internal Result
+evaluate_expression(Memory_Arena *arena, UTF8_String expression, Context *context)
+{
+	Token_List tokens = tokenize_expression(arena, expression, context->atoms);
+	AST *tree = parse_tokens(arena, tokens);
+	Program program = compile_tree(arena, tree, tokens);
+	Result result = run_program(arena, &program, context);
+	return(result);
+}
+
+internal u64
+find_variable_index(Context *context, Atom variable)
+{
+	u64 mask = context->capacity - 1;
+	u64 i = variable & mask;
+	while (context->variables[i] != Atom_None && context->variables[i] != variable)
+		i = (i + 1) & mask;
+	return(i);
+}
+
+internal Result
+lookup_variable(Context *context, Atom variable)
+{
+	Result result = {};
+	u64 i = find_variable_index(context, variable);
+	if (context->variables[i] != Atom_None)
+		result = { true, context->values[i] };
+	return(result);
+}
+
+internal Context
+make_context_with_table(Memory_Arena *arena, Atom_Table *atoms, u64 capacity)
 {
 	Context context = {};
-	context.variables = allocate_array(arena, UTF32_String, capacity);
+	context.arena     = arena;
+	context.atoms     = atoms;
+	context.variables = allocate_array(arena, Atom, capacity);
 	context.values    = allocate_array(arena, f64, capacity);
 	context.capacity  = capacity;
+	for (u64 i = 0; i < capacity; ++i)
+		context.variables[i] = Atom_None;
 	return(context);
+}
+
+void add_or_update_variable(Context *context, Atom variable, f64 value)
+{
+	if ((context->count + 1) * 4 > context->capacity * 3)
+	{
+		Context grown = make_context_with_table(context->arena, context->atoms, context->capacity * 2);
+		for (u64 i = 0; i < context->capacity; ++i)
+		{
+			if (context->variables[i] != Atom_None)
+			{
+				u64 j = find_variable_index(&grown, context->variables[i]);
+				grown.variables[j] = context->variables[i];
+				grown.values[j]    = context->values[i];
+			}
+		}
+		grown.count = context->count;
+		*context = grown;
+	}
+
+	u64 i = find_variable_index(context, variable);
+	if (context->variables[i] == Atom_None)
+	{
+		context->variables[i] = variable;
+		++context->count;
+	}
+	context->values[i] = value;
+}
+
+Context make_context(Memory_Arena *arena, Atom_Table *atoms, u64 capacity)
+{
+	// room for 'capacity' variables before the table has to grow
+	u64 table_capacity = 8;
+	while (table_capacity * 3 < capacity * 4)
+		table_capacity *= 2;
+	return(make_context_with_table(arena, atoms, table_capacity));
 }
\ No newline at end of file
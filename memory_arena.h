@@ -8,18 +8,29 @@ struct Memory_Arena
 	u64 used;
 };
 
-internal void *allocate_bytes(Memory_Arena *arena, u64 size);
-#define allocate_struct(arena, type)       (type *)allocate_bytes(arena, sizeof(type))
-#define allocate_array(arena, type, count) (type *)allocate_bytes(arena, sizeof(type) * count)
-#define allocate_arena(arena, size)        Memory_Arena{ allocate_bytes(arena, size), size, 0 }
+internal void *allocate_bytes(Memory_Arena *arena, u64 size, u64 alignment = 1);
+internal void *align_tail(Memory_Arena *arena, u64 alignment);
+#define allocate_struct(arena, type)       (type *)allocate_bytes(arena, sizeof(type), alignof(type))
+#define allocate_array(arena, type, count) (type *)allocate_bytes(arena, sizeof(type) * (count), alignof(type))
+#define allocate_arena(arena, size)        Memory_Arena{ (u8 *)allocate_bytes(arena, size), size, 0 }
 
-#define cast_tail(arena, type) (type *)(arena->data + arena->used)
+#define cast_tail(arena, type) (type *)align_tail(arena, alignof(type))
 
 //////////////////////
 
 internal void *
-allocate_bytes(Memory_Arena *arena, u64 size)
+align_tail(Memory_Arena *arena, u64 alignment)
 {
+	u64 misalignment = (u64)(arena->data + arena->used) % alignment;
+	if (misalignment)
+		allocate_bytes(arena, alignment - misalignment);
+	return(arena->data + arena->used);
+}
+
+internal void *
+allocate_bytes(Memory_Arena *arena, u64 size, u64 alignment)
+{
+	align_tail(arena, alignment);
 	assert(arena->used + size <= arena->size);
 	void *memory = (u8*)arena->data + arena->used;
 	arena->used += size;
@@ -62,43 +62,10 @@ colorf32(f32 luminosity, f32 alpha = 1.0f)
 	return color;
 }
 
-internal inline u32
-alpha_blend(u32 source, u32 destination)
-{
-	u32 result;
-
-	u32 source_alpha		= (source      >> 24) & 0xFF;
-	u32 destination_alpha	= (destination >> 24) & 0xFF;
-	u32 complement_alpha	= destination_alpha * (255 - source_alpha) / 255;
-	u32 out_alpha			= source_alpha + complement_alpha;
-
-	if (out_alpha)
-	{
-		u32 source_red   = (source >> 16) & 0xFF;
-		u32 source_green = (source >>  8) & 0xFF;
-		u32 source_blue  = (source >>  0) & 0xFF;
-
-		u32 destination_red   = (destination >> 16) & 0xFF;
-		u32 destination_green = (destination >>  8) & 0xFF;
-		u32 destination_blue  = (destination >>  0) & 0xFF;
-
-		u8 out_red   = (u8)((source_red   * source_alpha + destination_red   * complement_alpha) / out_alpha);
-		u8 out_green = (u8)((source_green * source_alpha + destination_green * complement_alpha) / out_alpha);
-		u8 out_blue  = (u8)((source_blue  * source_alpha + destination_blue  * complement_alpha) / out_alpha);
-
-		result = coloru8(out_red, out_green, out_blue, (u8)out_alpha);
-	}
-	else
-	{
-		result = coloru8(0, 0);
-	}
-
-	return(result);
-}
-
 internal void
 draw_rect (Canvas *graphics, s32 min_x, s32 min_y, s32 max_x, s32 max_y, u32 color)
 {
+	profile_block(Profile_Fill);
 	if (min_x > max_x)
 		swap(min_x, max_x);
 	if (min_y > max_y)
@@ -109,13 +76,29 @@ draw_rect (Canvas *graphics, s32 min_x, s32 min_y, s32 max_x, s32 max_y, u32 col
 	u32 x_max = (u32)clamp(max_x, 0, graphics->width);
 	u32 y_max = (u32)clamp(max_y, 0, graphics->height);
 
-	u32 stride = graphics->width + x_min - x_max;
+	u32 alpha = color >> 24;
+	if (x_min >= x_max || y_min >= y_max || !alpha)
+		return;
+
 	u32 *buffer = (u32*)graphics->buffer + y_min * graphics->width + x_min;
+	if (alpha == 255)
+	{
+		bool32 streaming = (u64)(x_max - x_min) * (y_max - y_min) * sizeof(u32) > BLEND_STREAMING_BYTES;
+		Blend_Fill_Span *fill_span = streaming? blend_kernels.stream_span : blend_kernels.fill_span;
+		for (u32 y = y_min; y < y_max; y++)
+		{
+			fill_span(buffer, x_max - x_min, color);
+			buffer += graphics->width;
+		}
+		if (streaming)
+			finish_streaming();
+		return;
+	}
+
 	for (u32 y = y_min; y < y_max; y++)
 	{
-		for (u32 x = x_min; x < x_max; x++)
-			*(buffer++) = alpha_blend(color, *buffer);
-		buffer += stride;
+		blend_kernels.color_span(buffer, x_max - x_min, color);
+		buffer += graphics->width;
 	}
 }
 
@@ -130,42 +113,154 @@ draw_bitmap(Canvas *graphics, u32 *buffer, s32 left, s32 top, u32 width, u32 hei
 
 	u32 max_x = (u32)minimum(left + width , graphics->width);
 	u32 max_y = (u32)minimum(top  + height, graphics->height);
-	u32 offscreen_right  = width  + left - max_x;
 	u32 offscreen_bottom = height + top  - max_y;
 
-	u32 *source = buffer + offscreen_top * width + offscreen_left;
-	u32 source_stride = offscreen_right + offscreen_left;
+	if (min_x >= max_x)
+		return;
 
+	u32 *source = buffer + offscreen_top * width + offscreen_left;
 	u32 *destination = (u32*)graphics->buffer + min_y * graphics->width + min_x;
-	u32 destination_stride = graphics->width + min_x - max_x;
-
 	for (u32 y = min_y; y < max_y; y++)
 	{
-		for (u32 x = min_x; x < max_x; x++)
+		blend_kernels.bitmap_span(destination, source, max_x - min_x);
+		source += width;
+		destination += graphics->width;
+	}
+}
+
+
+internal void
+init_glyph_cache(Memory_Arena *memory, Font *font, u32 cell_width, u32 cell_height)
+{
+	font->glyphs            = allocate_array(memory, Glyph, GLYPH_SLOT_COUNT);
+	font->glyph_code_points = allocate_array(memory, u32, GLYPH_SLOT_COUNT);
+	font->glyph_last_used   = allocate_array(memory, u64, GLYPH_SLOT_COUNT);
+	for (u32 i = 0; i < GLYPH_SLOT_COUNT; i++)
+	{
+		font->glyphs[i] = {};
+		font->glyphs[i].offset = i * cell_width * cell_height;
+		font->glyph_code_points[i] = GLYPH_SLOT_EMPTY;
+		font->glyph_last_used[i] = 0;
+	}
+	font->glyph_clock = 0;
+
+	font->atlas.stride      = cell_width;
+	font->atlas.cell_height = cell_height;
+	font->atlas.height      = cell_height * GLYPH_SLOT_COUNT;
+	font->atlas.pixels      = (u8*)allocate_bytes(memory, (u64)cell_width * font->atlas.height, 64);
+
+	// there are never more pages in use than slots
+	font->glyph_pages_by_code_point = allocate_array(memory, u16, 0x110000 >> 8);
+	font->glyph_pages    = (u16 (*)[256])allocate_array(memory, u16, (GLYPH_SLOT_COUNT + 1) * 256);
+	font->glyph_page_use = allocate_array(memory, u16, GLYPH_SLOT_COUNT + 1);
+	for (u32 i = 0; i < (0x110000 >> 8); i++)
+		font->glyph_pages_by_code_point[i] = 0;
+	for (u32 i = 0; i < (GLYPH_SLOT_COUNT + 1) * 256; i++)
+		font->glyph_pages[0][i] = 0;
+	for (u32 i = 0; i < GLYPH_SLOT_COUNT + 1; i++)
+		font->glyph_page_use[i] = 0;
+	for (u32 i = 0; i < 256; i++)
+		font->latin_glyphs[i] = 0;
+	font->missing_glyphs = allocate_array(memory, u8, 0x110000 / 8);
+	for (u32 i = 0; i < 0x110000 / 8; i++)
+		font->missing_glyphs[i] = 0;
+
+	{ // the box, in slot 0
+		Glyph *box = font->glyphs;
+		box->width   = (u16)minimum(maximum(font->line_height / 2, 3), cell_width);
+		box->height  = (u16)minimum(maximum(font->baseline * 3 / 4, 3), cell_height);
+		box->x       = -1;
+		box->y       = (s16)box->height;
+		box->advance = (s16)box->width + 2;
+		for (u32 y = 0; y < box->height; y++)
 		{
-			*(destination++) = alpha_blend(*(source++), *destination);
+			for (u32 x = 0; x < box->width; x++)
+			{
+				bool32 edge = !x || !y || x == box->width - 1u || y == box->height - 1u;
+				font->atlas.pixels[y * cell_width + x] = edge? 255 : 0;
+			}
 		}
-		source += source_stride;
-		destination += destination_stride;
 	}
 }
 
+internal u32
+find_glyph_slot(Font *font, u32 codepoint)
+{
+	u32 slot = 0;
+	if (codepoint < 256)
+		slot = font->latin_glyphs[codepoint];
+	else if (codepoint < 0x110000)
+		slot = font->glyph_pages[font->glyph_pages_by_code_point[codepoint >> 8]][codepoint & 0xFF];
+	return(slot);
+}
+
+internal void
+set_glyph_slot(Font *font, u32 codepoint, u16 slot)
+{
+	if (codepoint < 256)
+	{
+		font->latin_glyphs[codepoint] = slot;
+		return;
+	}
+
+	u16 *page = font->glyph_pages_by_code_point + (codepoint >> 8);
+	if (!*page)
+	{
+		// a free one, all zeroes
+		u16 free_page = 1;
+		while (font->glyph_page_use[free_page])
+			++free_page;
+		*page = free_page;
+	}
+
+	u16 *entry = font->glyph_pages[*page] + (codepoint & 0xFF);
+	if (slot && !*entry)
+		++font->glyph_page_use[*page];
+	else if (!slot && *entry)
+		--font->glyph_page_use[*page];
+	*entry = slot;
+
+	if (!font->glyph_page_use[*page])
+		*page = 0;
+}
 
 internal Glyph *
 get_glyph(Font *font, u32 codepoint)
 {
-	Glyph *glyph = 0;
-	u32 glyph_offset = 0;
-	for (u32 i = 0; i < font->range_count; i++)
+	u32 slot = find_glyph_slot(font, codepoint);
+	if (slot >= GLYPH_SLOT_COUNT)
+		return(font->pinned_glyphs + (slot - GLYPH_SLOT_COUNT));
+	if (!slot)
 	{
-		u32 *range = font->ranges[i];
-		if (codepoint >= range[0] && codepoint <= range[1])
+		if (codepoint >= 0x110000 || (font->missing_glyphs[codepoint / 8] & (1 << (codepoint % 8))))
+			return(font->glyphs);
+
+		profile_block(Profile_Rasterize_Glyph);
+
+		// the one used longest ago, or never
+		slot = 1;
+		for (u32 i = 2; i < GLYPH_SLOT_COUNT; i++)
 		{
-			glyph = font->glyphs + glyph_offset + codepoint - range[0];
-			break;
+			if (font->glyph_last_used[i] < font->glyph_last_used[slot])
+				slot = i;
+		}
+
+		Glyph glyph = {};
+		glyph.offset = font->glyphs[slot].offset;
+		if (!font->rasterize_glyph(font, codepoint, &glyph, font->atlas.pixels + glyph.offset, font->atlas.stride))
+		{
+			font->missing_glyphs[codepoint / 8] |= (u8)(1 << (codepoint % 8));
+			return(font->glyphs);
 		}
+
+		if (font->glyph_code_points[slot] != GLYPH_SLOT_EMPTY)
+			set_glyph_slot(font, font->glyph_code_points[slot], 0);
+		set_glyph_slot(font, codepoint, (u16)slot);
+		font->glyph_code_points[slot] = codepoint;
+		font->glyphs[slot] = glyph;
 	}
-	return(glyph);
+	font->glyph_last_used[slot] = ++font->glyph_clock;
+	return(font->glyphs + slot);
 }
 
 internal s32
@@ -189,24 +284,18 @@ draw_glyph(Canvas *graphics, Font *font, u32 codepoint, s32 left, s32 baseline,
 
 		s32 max_x = (s32)minimum(left + width , graphics->width);
 		s32 max_y = (s32)minimum(top  + height, graphics->height);
-		s32 offscreen_right  = width  + left - max_x;
 		s32 offscreen_bottom = height + top  - max_y;
 
-		u8 *source = glyph->buffer + offscreen_top * width + offscreen_left;
-		u32 source_stride = offscreen_right + offscreen_left;
-
+		Glyph_Atlas *atlas = glyph->pinned? &font->pinned_atlas : &font->atlas;
+		u32 source_stride = atlas->stride;
+		u8 *source = atlas->pixels + glyph->offset + offscreen_top * source_stride + offscreen_left;
 		u32 *destination = (u32*)graphics->buffer + min_y * graphics->width + min_x;
-		u32 destination_stride = graphics->width + min_x - max_x;
 
-		for (s32 y = min_y; y < max_y; y++)
+		for (s32 y = min_y; y < max_y && min_x < max_x; y++)
 		{
-			for (s32 x = min_x; x < max_x; x++)
-			{
-				u8 corrected_alpha = ((u32)*(source++) * (color >> 24)) / 255;
-				*(destination++) = alpha_blend((color & 0x00FFFFFF) | (corrected_alpha << 24), *destination);
-			}
+			blend_kernels.coverage_span(destination, source, max_x - min_x, color);
 			source += source_stride;
-			destination += destination_stride;
+			destination += graphics->width;
 		}
 	}
 	return(advance);
@@ -215,46 +304,43 @@ draw_glyph(Canvas *graphics, Font *font, u32 codepoint, s32 left, s32 baseline,
 internal s32
 draw_text(Canvas *graphics, Font *font, UTF32_String text, s32 x, s32 y, u32 color)
 {
+	profile_block(Profile_Draw_Text);
 	s32 offset = 0;
 	for (u64 i = 0; i < text.length; i++)
 	{
+		// no glyph reaches further left of where it starts than the width of its cell
+		if (x + offset - (s32)font->atlas.stride >= (s32)graphics->width)
+			break;
 		offset += draw_glyph(graphics, font, text[i], x + offset, y, color);
 	}
 	return(offset);
 }
 
 internal bool32
-codepoint_is_in_range(Font font, u32 codepoint)
+codepoint_is_printable(u32 codepoint)
 {
-	for (u64 i = 0; i < font.range_count; i++)
-	{
-		u32 *range = font.ranges[i];
-		if (codepoint <= range[1] && codepoint >= range[0])
-			return(true);
-	}
-	return(false);
+	// anything but control characters, and the halves of UTF-16 surrogate pairs
+	return(codepoint >= 32 && codepoint < 0x110000 &&
+		!(codepoint >= 0x7F && codepoint < 0xA0) &&
+		!(codepoint >= 0xD800 && codepoint < 0xE000));
 }
 
 internal s32
-get_text_width(Font* font, UTF32_String text, u64 cursor_position = 0, s32 *caret_offset = 0)
+get_text_width(Font* font, UTF32_String text)
 {
-	u32 position = 0;
 	s32 span = 0;
 	for (u64 i = 0; i < text.length; i++)
 	{
-		if (caret_offset && position++ == cursor_position)
-			*caret_offset = span;
 		Glyph* glyph = get_glyph(font, text[i]);
 		span += glyph->advance;
 	}
-	if (caret_offset && position == cursor_position)
-		*caret_offset = span;
 	return(span);
 }
 
 internal void
 recalculate_lines(Document *document)
 {
+	profile_block(Profile_Recalculate_Lines);
 	u64 i = 0;
 	u32 line = 0;
 	u64 line_start = 0;
@@ -292,19 +378,592 @@ recalculate_scroll(State *state, u32 height)
 		state->scroll_offset = scroll_into_cursor + state->font.line_height - height;
 }
 
+internal Line_Layout *
+get_line_layout(State *state, u64 index)
+{
+	// laid out again only once the line changes, after it has been evaluated
+	Layout_Cache *cache = &state->layout_cache;
+	UTF32_String line = state->document.lines[index];
+	u64 hash = state->line_cache.lines[index].hash;
+	assert(hash == hash_string(line));
+
+	Line_Layout *layout = 0;
+	Line_Layout *oldest = cache->lines;
+	for (u32 i = 0; i < LAYOUT_CACHE_LINES; i++)
+	{
+		Line_Layout *candidate = cache->lines + i;
+		if (candidate->last_used && candidate->hash == hash && candidate->length == line.length)
+		{
+			layout = candidate;
+			break;
+		}
+		if (candidate->last_used < oldest->last_used)
+			oldest = candidate;
+	}
+
+	if (!layout)
+	{
+		layout = oldest;
+		layout->hash   = hash;
+		layout->length = line.length;
+		layout->offsets[0] = 0;
+		for (u64 i = 0; i < line.length; i++)
+			layout->offsets[i + 1] = layout->offsets[i] + get_glyph(&state->font, line[i])->advance;
+	}
+	layout->last_used = ++cache->clock;
+	return(layout);
+}
+
 internal u64
-get_cursor_position_from_offset(Font *font, UTF32_String line, s32 offset)
+get_cursor_position_from_offset(Line_Layout *layout, s32 offset)
 {
-	u64 i = 0;
-	s32 span = 0;
-	for (; i < line.length; i++)
+	// the first character that ends past the offset, or the end of the line
+	u64 low  = 0;
+	u64 high = layout->length;
+	while (low < high)
 	{
-		Glyph* glyph = get_glyph(font, line[i]);
-		span += glyph->advance;
-		if (span > offset)
-			return(i);
+		u64 middle = (low + high) / 2;
+		if (layout->offsets[middle + 1] > offset)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return(low);
+}
+
+internal inline bool32
+results_are_identical(Result a, Result b)
+{
+	return(a.valid == b.valid && (!a.valid || a.value == b.value));
+}
+
+internal bool32
+changes_contain(Variable_Changes *changes, Atom atom)
+{
+	if (changes->everything)
+		return(true);
+	for (u32 i = 0; i < changes->count; ++i)
+	{
+		if (changes->atoms[i] == atom)
+			return(true);
+	}
+	return(false);
+}
+
+internal void
+add_change(Variable_Changes *changes, Atom atom)
+{
+	for (u32 i = 0; i < changes->count; ++i)
+	{
+		if (changes->atoms[i] == atom)
+			return;
+	}
+	if (changes->count < array_count(changes->atoms))
+		changes->atoms[changes->count++] = atom;
+	else
+		changes->everything = true;
+}
+
+internal void
+remove_change(Variable_Changes *changes, Atom atom)
+{
+	for (u32 i = 0; i < changes->count; ++i)
+	{
+		if (changes->atoms[i] == atom)
+		{
+			changes->atoms[i] = changes->atoms[--changes->count];
+			return;
+		}
+	}
+}
+
+internal void
+store_program(Memory_Arena *arena, Cached_Line *line)
+{
+	Program *program = &line->program;
+	Instruction     *code      = allocate_array(arena, Instruction, program->code_count);
+	f64             *constants = allocate_array(arena, f64, program->constant_count);
+	Atom            *atoms     = allocate_array(arena, Atom, program->slot_count);
+	Cached_Variable *slots     = allocate_array(arena, Cached_Variable, program->slot_count);
+	for (u32 i = 0; i < program->code_count; ++i)
+		code[i] = program->code[i];
+	for (u32 i = 0; i < program->constant_count; ++i)
+		constants[i] = program->constants[i];
+	for (u32 i = 0; i < program->slot_count; ++i)
+	{
+		atoms[i] = program->slots[i];
+		slots[i] = line->slots[i];
+	}
+
+	program->code      = code;
+	program->constants = constants;
+	program->slots     = atoms;
+	line->slots        = slots;
+}
+
+internal u64
+get_program_storage_size(Program *program)
+{
+	return(
+		program->code_count     * sizeof(Instruction) +
+		program->constant_count * sizeof(f64) +
+		program->slot_count     * (sizeof(Atom) + sizeof(Cached_Variable)) + 4 * alignof(f64));
+}
+
+internal void
+reserve_program_storage(Line_Cache *cache, u64 line_count, Program *program)
+{
+	u64 size = get_program_storage_size(program);
+	if (cache->programs.used + size > cache->programs.size)
+	{
+		u64 needed = size;
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			if (cache->lines[i].program.code)
+				needed += get_program_storage_size(&cache->lines[i].program);
+		}
+		u64 grown_size = 0;
+		if (needed > cache->spare.size)
+		{
+			grown_size = 2 * maximum(cache->spare.size, needed);
+			cache->spare = { (u8*)allocate_bytes(cache->arena, grown_size, 16), grown_size };
+		}
+
+		cache->spare.used = 0;
+		for (u64 i = 0; i < line_count; ++i)
+		{
+			if (cache->lines[i].program.code)
+				store_program(&cache->spare, cache->lines + i);
+		}
+		swap(cache->programs, cache->spare);
+		if (grown_size)
+			cache->spare = { (u8*)allocate_bytes(cache->arena, grown_size, 16), grown_size };
+	}
+}
+
+internal Line_Cache
+make_line_cache(Memory_Arena *arena, u64 line_capacity, u64 program_bytes)
+{
+	Line_Cache cache = {};
+	cache.lines = allocate_array(arena, Cached_Line, line_capacity);
+	for (u64 i = 0; i < line_capacity; ++i)
+		cache.lines[i] = {};
+	cache.arena    = arena;
+	cache.programs = { (u8*)allocate_bytes(arena, program_bytes, 16), program_bytes };
+	cache.spare    = { (u8*)allocate_bytes(arena, program_bytes, 16), program_bytes };
+	cache.identifiers       = allocate_struct(arena, Memory_Arena);
+	cache.spare_identifiers = allocate_struct(arena, Memory_Arena);
+	*cache.identifiers       = allocate_arena(arena, kibibytes(512));
+	*cache.spare_identifiers = allocate_arena(arena, kibibytes(512));
+	cache.atoms = make_atom_table(cache.identifiers, 256);
+	cache.pending_line = line_capacity;
+	// an empty document is one line, still to be evaluated
+	cache.lines[0].dirty = true;
+	return(cache);
+}
+
+internal Defining_Lines *
+get_defining_lines(Line_Cache *cache, Atom atom)
+{
+	if (atom >= cache->definition_count)
+	{
+		u32 count = (u32)maximum(cache->atoms.capacity, atom + 1);
+		Defining_Lines *grown = allocate_array(cache->atoms.arena, Defining_Lines, count);
+		for (u32 i = 0; i < count; ++i)
+			grown[i] = (i < cache->definition_count)? cache->definitions[i] : Defining_Lines{};
+		cache->definitions      = grown;
+		cache->definition_count = count;
+	}
+	return(cache->definitions + atom);
+}
+
+internal u32
+count_defining_lines_above(Defining_Lines *definitions, u64 index)
+{
+	u32 low  = 0;
+	u32 high = definitions->count;
+	while (low < high)
+	{
+		u32 middle = (low + high) / 2;
+		if (definitions->lines[middle] < index)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return(low);
+}
+
+internal void
+add_defining_line(Line_Cache *cache, Atom atom, u64 index)
+{
+	Defining_Lines *definitions = get_defining_lines(cache, atom);
+	u32 at = count_defining_lines_above(definitions, index);
+	if (at < definitions->count && definitions->lines[at] == index)
+		return;
+
+	if (definitions->count == definitions->capacity)
+	{
+		u32 capacity = (u32)maximum(2 * definitions->capacity, 4);
+		u32 *lines = allocate_array(cache->atoms.arena, u32, capacity);
+		for (u32 i = 0; i < definitions->count; ++i)
+			lines[i] = definitions->lines[i];
+		definitions->lines    = lines;
+		definitions->capacity = capacity;
+	}
+	for (u32 i = definitions->count; i > at; --i)
+		definitions->lines[i] = definitions->lines[i - 1];
+	definitions->lines[at] = (u32)index;
+	++definitions->count;
+}
+
+internal void
+remove_defining_line(Line_Cache *cache, Atom atom, u64 index)
+{
+	if (atom >= cache->definition_count)
+		return;
+	Defining_Lines *definitions = cache->definitions + atom;
+	u32 at = count_defining_lines_above(definitions, index);
+	if (at == definitions->count || definitions->lines[at] != index)
+		return;
+	--definitions->count;
+	for (u32 i = at; i < definitions->count; ++i)
+		definitions->lines[i] = definitions->lines[i + 1];
+}
+
+internal void
+move_defining_lines(Line_Cache *cache, u64 edited_line, s64 delta)
+{
+	// the lines below the edited one moved by delta, and when it's negative the first of them are gone
+	for (u32 atom = 0; atom < cache->definition_count; ++atom)
+	{
+		Defining_Lines *definitions = cache->definitions + atom;
+		u32 kept = 0;
+		for (u32 i = 0; i < definitions->count; ++i)
+		{
+			u64 line = definitions->lines[i];
+			if (line > edited_line && (s64)(line - edited_line) <= -delta)
+				continue;
+			definitions->lines[kept++] = (u32)(line > edited_line? line + delta : line);
+		}
+		definitions->count = kept;
+	}
+}
+
+internal void
+recycle_atoms(Line_Cache *cache, u64 line_count)
+{
+	// the lines' programs and what's pending are moved over to the new atoms, and the index rebuilt
+	Atom_Table old = cache->atoms;
+	cache->spare_identifiers->used = 0;
+	cache->atoms = make_atom_table(cache->spare_identifiers, 256);
+	swap(cache->identifiers, cache->spare_identifiers);
+	cache->definitions      = 0;
+	cache->definition_count = 0;
+
+	for (u32 i = 0; i < cache->pending.count; ++i)
+		cache->pending.atoms[i] = intern(&cache->atoms, old.names[cache->pending.atoms[i]]);
+	for (u64 i = 0; i < line_count; ++i)
+	{
+		Cached_Line *line = cache->lines + i;
+		for (u32 j = 0; j < line->program.slot_count; ++j)
+		{
+			line->program.slots[j] = intern(&cache->atoms, old.names[line->program.slots[j]]);
+			if (!results_are_identical(line->slots[j].before, line->slots[j].after))
+				add_defining_line(cache, line->program.slots[j], i);
+		}
+	}
+}
+
+internal Result
+find_variable_before(Line_Cache *cache, u64 index, Atom atom)
+{
+	if (atom == Atom_Prev)
+		return(index? cache->lines[index - 1].prev : Result{});
+	if (atom == Atom_Sum)
+		return(index? cache->lines[index - 1].sum : Result{});
+
+	// the closest line above that changed it
+	if (atom >= cache->definition_count)
+		return(Result{});
+	Defining_Lines *definitions = cache->definitions + atom;
+	u32 above = count_defining_lines_above(definitions, index);
+	if (!above)
+		return(Result{});
+	Cached_Line *line = cache->lines + definitions->lines[above - 1];
+	for (u32 j = 0; j < line->program.slot_count; ++j)
+	{
+		if (line->program.slots[j] == atom)
+			return(line->slots[j].after);
+	}
+	return(Result{});
+}
+
+internal void
+update_implicit_variables(Line_Cache *cache, u64 index, Variable_Changes *changes)
+{
+	Cached_Line *line = cache->lines + index;
+	Result prev = index? cache->lines[index - 1].prev : Result{};
+	Result sum  = index? cache->lines[index - 1].sum  : Result{};
+
+	// they can be assigned like any other variable before the line's result updates them
+	for (u32 i = 0; i < line->program.slot_count; ++i)
+	{
+		if (line->program.slots[i] == Atom_Prev)
+			prev = line->slots[i].after;
+		else if (line->program.slots[i] == Atom_Sum)
+			sum = line->slots[i].after;
+	}
+	if (line->result.valid)
+	{
+		prev = line->result;
+		sum  = { true, sum.value + line->result.value };
+	}
+
+	if (results_are_identical(prev, line->prev))
+		remove_change(changes, Atom_Prev);
+	else
+		add_change(changes, Atom_Prev);
+	if (results_are_identical(sum, line->sum))
+		remove_change(changes, Atom_Sum);
+	else
+		add_change(changes, Atom_Sum);
+
+	line->prev = prev;
+	line->sum  = sum;
+}
+
+internal void
+evaluate_line(Line_Cache *cache, Document *document, u64 index, Memory_Arena *temp, Variable_Changes *changes)
+{
+	profile_block(Profile_Evaluate_Line);
+	Cached_Line *line = cache->lines + index;
+	UTF32_String text = document->lines[index];
+	u64 hash = hash_string(text);
+
+	// what the line wrote last time, to tell which variables read differently below it
+	u32 old_write_count = 0;
+	Atom   *old_writes      = allocate_array(temp, Atom, line->program.slot_count);
+	Result *old_write_values = allocate_array(temp, Result, line->program.slot_count);
+	for (u32 i = 0; i < line->program.slot_count; ++i)
+	{
+		if (!results_are_identical(line->slots[i].before, line->slots[i].after))
+		{
+			old_writes[old_write_count] = line->program.slots[i];
+			old_write_values[old_write_count++] = line->slots[i].after;
+		}
+	}
+
+	if (!line->program.code || line->hash != hash)
+	{
+		Token_List tokens = tokenize_expression(temp, make_utf8_from_string(temp, text), &cache->atoms);
+		AST *tree = parse_tokens(temp, tokens);
+		Program program = compile_tree(temp, tree, tokens);
+
+		line->program = {};
+		reserve_program_storage(cache, document->line_count, &program);
+
+		line->program = program;
+		line->slots   = allocate_array(temp, Cached_Variable, program.slot_count);
+		for (u32 i = 0; i < program.slot_count; ++i)
+			line->slots[i] = {};
+		store_program(&cache->programs, line);
+		line->hash = hash;
+	}
+
+	Program program = line->program;
+	Context context = make_context(temp, &cache->atoms, program.slot_count);
+	for (u32 i = 0; i < program.slot_count; ++i)
+	{
+		Cached_Variable *slot = line->slots + i;
+		slot->before = find_variable_before(cache, index, program.slots[i]);
+		if (slot->before.valid)
+			add_or_update_variable(&context, program.slots[i], slot->before.value);
+	}
+
+	Result result = run_program(temp, &program, &context);
+
+	for (u32 i = 0; i < program.slot_count; ++i)
+		line->slots[i].after = context[program.slots[i]];
+
+	for (u32 i = 0; i < old_write_count; ++i)
+	{
+		bool32 still_written = false;
+		for (u32 j = 0; j < program.slot_count; ++j)
+		{
+			Cached_Variable *slot = line->slots + j;
+			if (program.slots[j] == old_writes[i] && !results_are_identical(slot->before, slot->after))
+				still_written = true;
+		}
+		if (!still_written)
+			add_change(changes, old_writes[i]);
+	}
+	for (u32 i = 0; i < program.slot_count; ++i)
+	{
+		Cached_Variable *slot = line->slots + i;
+		if (!results_are_identical(slot->before, slot->after))
+		{
+			// writing what it wrote before hides any change from above
+			bool32 is_same = false;
+			for (u32 j = 0; !line->absorbed_lines && j < old_write_count; ++j)
+			{
+				if (old_writes[j] == program.slots[i] && results_are_identical(old_write_values[j], slot->after))
+					is_same = true;
+			}
+			if (is_same)
+				remove_change(changes, program.slots[i]);
+			else
+				add_change(changes, program.slots[i]);
+		}
 	}
-	return(i);
+
+	// and keep find_variable_before's index of them
+	for (u32 i = 0; i < old_write_count; ++i)
+		remove_defining_line(cache, old_writes[i], index);
+	for (u32 i = 0; i < program.slot_count; ++i)
+	{
+		if (!results_are_identical(line->slots[i].before, line->slots[i].after))
+			add_defining_line(cache, program.slots[i], index);
+	}
+
+	if (result.valid && !(line->result.valid && result.value == line->result.value))
+	{
+		profile_block(Profile_Format_Result);
+		line->result_length = (u32)format_f64(line->result_text, array_count(line->result_text), result.value);
+	}
+	line->result = result;
+	line->dirty  = false;
+	line->absorbed_lines = false;
+
+	update_implicit_variables(cache, index, changes);
+}
+
+internal void
+evaluate_document(Line_Cache *cache, Document *document, Memory_Arena *temp)
+{
+	profile_block(Profile_Evaluate_Document);
+	// a pass interns at most what the document's text names, far less than the half left
+	if (cache->identifiers->used > cache->identifiers->size / 2)
+		recycle_atoms(cache, document->line_count);
+
+	// only edited lines, and the lines reading what they changed, are evaluated again
+	Variable_Changes changes = {};
+	for (u64 i = cache->first_dirty_line; i < document->line_count; ++i)
+	{
+		if (i > cache->last_dirty_line && !changes.count && !changes.everything)
+			break;
+
+		if (i == cache->pending_line)
+		{
+			changes.everything |= cache->pending.everything;
+			for (u32 j = 0; j < cache->pending.count; ++j)
+				add_change(&changes, cache->pending.atoms[j]);
+		}
+
+		Cached_Line *line = cache->lines + i;
+		bool32 is_affected = line->dirty;
+		for (u32 j = 0; !is_affected && j < line->program.slot_count; ++j)
+			is_affected = changes_contain(&changes, line->program.slots[j]);
+
+		u64 used = temp->used;
+		if (is_affected)
+			evaluate_line(cache, document, i, temp, &changes);
+		else
+			update_implicit_variables(cache, i, &changes);
+		temp->used = used;
+	}
+
+	cache->first_dirty_line = document->line_capacity;
+	cache->last_dirty_line  = 0;
+	cache->pending          = {};
+	cache->pending_line     = document->line_capacity;
+}
+
+internal void
+invalidate_lines(Line_Cache *cache, Document *document, u64 edited_line, u32 previous_line_count)
+{
+	s64 delta = (s64)document->line_count - (s64)previous_line_count;
+	if (delta > 0)
+	{
+		for (u64 i = previous_line_count; i-- > edited_line + 1;)
+			cache->lines[i + delta] = cache->lines[i];
+		// new lines start out as the edited one left things, so they only report what they change
+		for (u64 i = edited_line + 1; i <= edited_line + delta; ++i)
+		{
+			cache->lines[i] = {};
+			cache->lines[i].prev = cache->lines[edited_line].prev;
+			cache->lines[i].sum  = cache->lines[edited_line].sum;
+		}
+	}
+	else if (delta < 0)
+	{
+		// whatever the removed lines wrote reads differently from here on
+		u64 removed = (u64)-delta;
+		for (u64 i = edited_line + 1; i <= edited_line + removed; ++i)
+		{
+			Cached_Line *line = cache->lines + i;
+			for (u32 j = 0; j < line->program.slot_count; ++j)
+			{
+				if (!results_are_identical(line->slots[j].before, line->slots[j].after))
+					add_change(&cache->pending, line->program.slots[j]);
+			}
+		}
+		add_change(&cache->pending, Atom_Prev);
+		add_change(&cache->pending, Atom_Sum);
+
+		Cached_Line *edited = cache->lines + edited_line;
+		edited->prev = cache->lines[edited_line + removed].prev;
+		edited->sum  = cache->lines[edited_line + removed].sum;
+		edited->absorbed_lines = true;
+
+		for (u64 i = edited_line + 1; i + removed < previous_line_count; ++i)
+			cache->lines[i] = cache->lines[i + removed];
+		for (u64 i = document->line_count; i < previous_line_count; ++i)
+			cache->lines[i] = {};
+	}
+
+	if (delta)
+		move_defining_lines(cache, edited_line, delta);
+
+	if (cache->pending_line > edited_line && cache->pending_line < document->line_capacity)
+		cache->pending_line = (u64)maximum(edited_line, cache->pending_line + delta);
+	if (delta < 0)
+		cache->pending_line = minimum(cache->pending_line, edited_line);
+
+	if (cache->last_dirty_line > edited_line)
+		cache->last_dirty_line = (u64)maximum(edited_line, cache->last_dirty_line + delta);
+
+	u64 last_edited_line = edited_line + maximum(delta, 0);
+	for (u64 i = edited_line; i <= last_edited_line; ++i)
+		cache->lines[i].dirty = true;
+	cache->first_dirty_line = minimum(cache->first_dirty_line, edited_line);
+	cache->last_dirty_line  = maximum(cache->last_dirty_line, last_edited_line);
+}
+
+internal void
+recalculate_document(State *state, u64 edited_line)
+{
+	u32 previous_line_count = state->document.line_count;
+	recalculate_lines(&state->document);
+	invalidate_lines(&state->line_cache, &state->document, edited_line, previous_line_count);
+}
+
+internal void
+insert_at_cursor(State *state, UTF32_String text)
+{
+	// the lines it spans are the edited one and those its newlines make, which recalculate_document
+	// marks dirty; the cursor goes to the end of it, which may be on one of them
+	Document *document = &state->document;
+	u64 at = (document->lines[state->cursor_line].data - document->buffer.data) + state->cursor_position_in_line;
+	if (!insert_string_if_fits(&document->buffer, text, at))
+		return;
+	recalculate_document(state, state->cursor_line);
+
+	u64 end = at + text.length;
+	u64 line = state->cursor_line;
+	while ((u64)(document->lines[line].data - document->buffer.data) + document->lines[line].length < end)
+		++line;
+	state->cursor_line = line;
+	state->cursor_position_in_line = end - (document->lines[line].data - document->buffer.data);
 }
 
 internal inline bool32
@@ -316,6 +975,7 @@ button_was_pressed(Input_Button button) // went from 'up' to 'down' at least onc
 internal bool32
 process_keyboard(State *state, Keyboard_Input *keyboard)
 {
+	profile_block(Profile_Input);
 	bool32 should_snap_scroll = false;
 	if (button_was_pressed(keyboard->up))
 	{
@@ -374,11 +1034,8 @@ process_keyboard(State *state, Keyboard_Input *keyboard)
 
 	if (button_was_pressed(keyboard->enter))
 	{
-		insert_character_if_fits(&state->document.buffer, '\n',
-			(state->document.lines[state->cursor_line].data - state->document.buffer.data) + state->cursor_position_in_line);
-		recalculate_lines(&state->document);
-		++state->cursor_line;
-		state->cursor_position_in_line = 0;
+		u32 newline = '\n';
+		insert_at_cursor(state, UTF32_String{ &newline, 1, 1 });
 		should_snap_scroll = true;
 	}
 	if (button_was_pressed(keyboard->backspace))
@@ -396,7 +1053,7 @@ process_keyboard(State *state, Keyboard_Input *keyboard)
 				--state->cursor_position_in_line;
 			remove_from_string(&state->document.buffer,
 				(state->document.lines[cursor_line].data - state->document.buffer.data) + cursor_position_in_line - 1, 1);
-			recalculate_lines(&state->document);
+			recalculate_document(state, state->cursor_line);
 		}
 		should_snap_scroll = true;
 	}
@@ -407,7 +1064,7 @@ process_keyboard(State *state, Keyboard_Input *keyboard)
 		{
 			remove_from_string(&state->document.buffer,
 				(state->document.lines[state->cursor_line].data - state->document.buffer.data) + state->cursor_position_in_line, 1);
-			recalculate_lines(&state->document);
+			recalculate_document(state, state->cursor_line);
 		}
 		should_snap_scroll = true;
 	}
@@ -424,20 +1081,179 @@ process_keyboard(State *state, Keyboard_Input *keyboard)
 
 	if (keyboard->input_buffer.length)
 	{
-		insert_string_if_fits(&state->document.buffer, keyboard->input_buffer,
-			(state->document.lines[state->cursor_line].data - state->document.buffer.data) + state->cursor_position_in_line);
-		state->cursor_position_in_line += keyboard->input_buffer.length;
+		insert_at_cursor(state, keyboard->input_buffer);
 		keyboard->input_buffer.length = 0;
-		recalculate_lines(&state->document);
 		should_snap_scroll = true;
 	}
 
 	return(should_snap_scroll);
 }
 
+internal inline u64
+mix_signature(u64 signature, u64 value)
+{
+	return((signature ^ value) * 0x100000001B3ULL);
+}
+
+internal u64
+get_line_signature(State *state, u64 index, bool32 copy_is_down)
+{
+	// everything drawing the line depends on, other than where it goes
+	Cached_Line *evaluation = state->line_cache.lines + index;
+	u64 signature = mix_signature(mix_signature(evaluation->hash, state->document.lines[index].length), index);
+	if (index == state->cursor_line)
+		signature = mix_signature(mix_signature(signature, state->cursor_position_in_line + 1), copy_is_down);
+	if (evaluation->result.valid)
+	{
+		UTF32_String result = { evaluation->result_text, evaluation->result_length, evaluation->result_length };
+		signature = mix_signature(signature, hash_string(result));
+	}
+	return(signature);
+}
+
+internal void
+add_dirty_rect(Canvas *canvas, s32 min_y, s32 max_y)
+{
+	// the width of the canvas, merged with every band it touches
+	min_y = (s32)maximum(min_y, 0);
+	max_y = (s32)minimum(max_y, canvas->height);
+	if (min_y >= max_y)
+		return;
+
+	for (u32 i = 0; i < canvas->dirty_rect_count;)
+	{
+		Rect *rect = canvas->dirty_rects + i;
+		bool32 is_full = canvas->dirty_rect_count == array_count(canvas->dirty_rects);
+		if ((rect->min_y <= max_y && min_y <= rect->max_y) || (is_full && i == canvas->dirty_rect_count - 1))
+		{
+			min_y = (s32)minimum(min_y, rect->min_y);
+			max_y = (s32)maximum(max_y, rect->max_y);
+			*rect = canvas->dirty_rects[--canvas->dirty_rect_count];
+			i = 0;
+		}
+		else
+			++i;
+	}
+	canvas->dirty_rects[canvas->dirty_rect_count++] = { 0, min_y, (s32)canvas->width, max_y };
+}
+
+internal void
+draw_line(Canvas *canvas, State *state, u64 index, s32 vertical_offset, bool32 copy_is_down, Memory_Arena *temp)
+{
+	Font *font = &state->font;
+	UTF32_String line = state->document.lines[index];
+	s32 horizontal_offset = state->line_number_bar_width;
+	s32 baseline = vertical_offset + font->baseline;
+
+	if (index == state->cursor_line)
+	{
+		{ 	// line highlight
+			draw_rect(canvas,
+				horizontal_offset,vertical_offset,
+				canvas->width,    vertical_offset + font->line_height,
+				colorf32(0.95f));
+
+			// line number highlight
+			draw_rect(canvas,
+				0, vertical_offset,
+				horizontal_offset, vertical_offset + font->line_height,
+				colorf32(0.85f));
+		}
+
+		// caret
+		Line_Layout *layout = get_line_layout(state, index);
+		s32 caret_offset = horizontal_offset + layout->offsets[minimum(state->cursor_position_in_line, layout->length)];
+		draw_rect(canvas,
+			caret_offset, vertical_offset,
+			caret_offset + state->caret_width, vertical_offset + font->line_height,
+			coloru8(0));
+	}
+
+	// line numbers
+	u64 used = temp->used;
+	UTF32_String line_number = convert_s64_to_string(temp, index + 1);
+	s32 line_number_width = get_text_width(font, line_number);
+	draw_text(canvas, font, line_number,
+		horizontal_offset - line_number_width - 5, baseline,
+		(index == state->cursor_line)? coloru8(0, 200) : coloru8(0, 128));
+	temp->used = used;
+
+	// line content
+	draw_text(canvas, font, line, horizontal_offset, baseline, coloru8(0));
+
+	Cached_Line *evaluation = state->line_cache.lines + index;
+	if (evaluation->result.valid)
+	{
+		UTF32_String result = { evaluation->result_text, evaluation->result_length, evaluation->result_length };
+		u32 result_color = coloru8(0, 128);
+		if (index == state->cursor_line && copy_is_down)
+			result_color = coloru8(100, 100, 255, 200);
+
+		s32 result_width = get_text_width(font, result);
+		draw_text(canvas, font, result, canvas->width - result_width, baseline, result_color);
+	}
+}
+
+#if PROFILE && DEBUG
+internal s32
+get_profile_overlay_height(Font *font)
+{
+	return((Profile_Stage_Count + 1) * font->line_height + 10);
+}
+
+internal void
+draw_profile_overlay(Canvas *canvas, Font *font, Memory_Arena *temp)
+{
+	// the median and 99th percentile time of every stage, in microseconds, over the last frames
+	UTF32_String headers[3] = {
+		make_string_from_chars(temp, "us"),
+		make_string_from_chars(temp, "p50"),
+		make_string_from_chars(temp, "p99"),
+	};
+	s32 column_width = get_text_width(font, make_string_from_chars(temp, "  99999.9"));
+	s32 name_width = 0;
+	for (u32 i = 0; i < Profile_Stage_Count; ++i)
+		name_width = (s32)maximum(name_width, get_text_width(font, make_string_from_chars(temp, profile_stage_names[i])));
+
+	s32 width  = name_width + 2 * column_width + 10;
+	s32 height = get_profile_overlay_height(font);
+	s32 left = canvas->width - width;
+	s32 top  = 0;
+	draw_rect(canvas, left, top, canvas->width, top + height, coloru8(255, 220));
+
+	s32 baseline = top + 5 + font->baseline;
+	draw_text(canvas, font, headers[0], left + 5, baseline, coloru8(0, 128));
+	for (u32 j = 1; j < 3; ++j)
+	{
+		s32 right = left + name_width + 5 + j * column_width;
+		draw_text(canvas, font, headers[j], right - get_text_width(font, headers[j]), baseline, coloru8(0, 128));
+	}
+	for (u32 i = 0; i < Profile_Stage_Count; ++i)
+	{
+		baseline += font->line_height;
+		draw_text(canvas, font, make_string_from_chars(temp, profile_stage_names[i]), left + 5, baseline, coloru8(0, 200));
+
+		f64 percentiles[2];
+		if (!get_profile_percentiles(temp, (Profile_Stage)i, percentiles, percentiles + 1))
+			continue;
+		for (u32 j = 0; j < 2; ++j)
+		{
+			u32 digits[32];
+			UTF32_String text = { digits, array_count(digits), 0 };
+			text.length = format_f64(digits, array_count(digits), percentiles[j], 1);
+			s32 right = left + name_width + 5 + (j + 1) * column_width;
+			draw_text(canvas, font, text, right - get_text_width(font, text), baseline, coloru8(0, 200));
+		}
+	}
+}
+#endif
+
 internal void
 update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_Input *time, Keyboard_Input *keyboard, Mouse_Input *mouse)
 {
+#if PROFILE
+	begin_profile_frame();
+#endif
 	State *state = (State*)arena->data;
 	Memory_Arena temp = { arena->data + sizeof(State), kibibytes(50) };
 
@@ -446,6 +1262,7 @@ update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_
 		allocate_struct(arena, State);
 		allocate_bytes(arena, temp.size);
 
+		blend_kernels = select_blend_kernels();
 		state->font = platform->load_font(arena, "data/fira.ttf", 20);
 		state->caret_width = 1;
 		state->line_number_bar_width = 40;
@@ -455,7 +1272,19 @@ update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_
 		state->document.lines  = allocate_array(arena, UTF32_String, state->document.line_capacity);
 		recalculate_lines(&state->document);
 
+		Line_Cache *line_cache = &state->line_cache;
+		*line_cache = make_line_cache(arena, state->document.line_capacity, kibibytes(256));
+
 		keyboard->input_buffer = make_empty_string(arena, 256);
+
+		// no line is longer than the document
+		Layout_Cache *layout_cache = &state->layout_cache;
+		for (u32 i = 0; i < LAYOUT_CACHE_LINES; ++i)
+		{
+			layout_cache->lines[i] = {};
+			layout_cache->lines[i].offsets = allocate_array(arena, s32, state->document.buffer.capacity + 1);
+		}
+		layout_cache->clock = 0;
 	}
 
 	bool32 should_snap_scroll = process_keyboard(state, keyboard);
@@ -464,99 +1293,60 @@ update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_
 
 	if (button_was_pressed(keyboard->paste))
 	{
+		profile_block(Profile_Input);
 		UTF32_String pasted = platform->pop_from_clipboard(arena);
-		insert_string_if_fits(&state->document.buffer, pasted,
-			(state->document.lines[state->cursor_line].data - state->document.buffer.data) + state->cursor_position_in_line);
-		state->cursor_position_in_line += pasted.length;
+		insert_at_cursor(state, pasted);
 		arena->used -= pasted.length * sizeof(u32);
-		recalculate_lines(&state->document);
 	}
 
-	s32 horizontal_offset = state->line_number_bar_width;
-
-	// background
-	draw_rect(canvas, horizontal_offset, 0, canvas->width, canvas->height, colorf32(1));
-	// line number sidebar
-	draw_rect(canvas, 0, 0, horizontal_offset, canvas->height, colorf32(0.9f));
+	evaluate_document(&state->line_cache, &state->document, &temp);
 
-	Context context = make_context(&temp, 100);
-
-	UTF32_String prev_var = make_string_from_chars(&temp, "prev");
-	UTF32_String sum_var  = make_string_from_chars(&temp, "sum");
+	Font *font = &state->font;
+	s32 horizontal_offset = state->line_number_bar_width;
+	u64 min = state->scroll_offset / font->line_height;
+	u64 max = minimum(min + canvas->height / font->line_height + 1, state->document.line_count);
 
-	// @TODO: clamp to visible area
-	u64 min = state->scroll_offset / state->font.line_height;
-	u64 max = minimum(min + canvas->height / state->font.line_height + 1, state->document.line_count);
-	for (u64 i = min; i < max; i++)
+	// the cursor goes where the mouse is before anything is drawn
+	for (u64 i = min; i < max && mouse->left.is_down; i++)
 	{
-		UTF32_String line = state->document.lines[i];
-
-		s32 vertical_offset = (s32)(state->font.line_height * i - state->scroll_offset);
-		s32 baseline = vertical_offset + state->font.baseline;
-
-		if (i == state->cursor_line)
+		s32 vertical_offset = (s32)(font->line_height * i - state->scroll_offset);
+		if (mouse->y >= vertical_offset && mouse->y < (s32)(vertical_offset + font->line_height))
 		{
-			{ 	// line highlight
-				draw_rect(canvas,
-					horizontal_offset,vertical_offset,
-					canvas->width,    vertical_offset + state->font.line_height,
-					colorf32(0.95f));
-
-				// line number highlight
-				draw_rect(canvas,
-					0, vertical_offset,
-					horizontal_offset, vertical_offset + state->font.line_height,
-					colorf32(0.85f));
-			}
-
-			// caret
-			s32 caret_offset = 0;
-			get_text_width(&state->font, line, state->cursor_position_in_line, &caret_offset);
-			caret_offset += horizontal_offset;
-			draw_rect(canvas,
-				caret_offset, vertical_offset,
-				caret_offset + state->caret_width, vertical_offset + state->font.line_height,
-				coloru8(0));
+			state->cursor_line = i;
+			state->cursor_position_in_line = get_cursor_position_from_offset(get_line_layout(state, i), (s32)maximum(mouse->x - horizontal_offset, 0));
 		}
+	}
 
-		if (mouse->left.is_down)
-		{
-			if (mouse->y >= vertical_offset && mouse->y < (s32)(vertical_offset + state->font.line_height))
-			{
-				state->cursor_line = i;
-				state->cursor_position_in_line = get_cursor_position_from_offset(&state->font, line, (s32)maximum(mouse->x - horizontal_offset, 0));
-			}
-		}
-
-		// line numbers
-		UTF32_String line_number = convert_s64_to_string(&temp, i+1);
-		s32 line_number_width = get_text_width(&state->font, line_number);
-		draw_text(canvas, &state->font, line_number,
-			horizontal_offset - line_number_width - 5, baseline,
-			(i == state->cursor_line)? coloru8(0, 200) : coloru8(0, 128));
-
-	    // line content
-		draw_text(canvas, &state->font, line, horizontal_offset, baseline, coloru8(0));
+	bool32 copy_is_down = keyboard->copy.is_down;
+	if (button_was_pressed(keyboard->copy) && state->cursor_line >= min && state->cursor_line < max)
+	{
+		Cached_Line *evaluation = state->line_cache.lines + state->cursor_line;
+		if (evaluation->result.valid)
+			platform->push_to_clipboard({ evaluation->result_text, evaluation->result_length, evaluation->result_length });
+	}
 
-		Result evaluation = evaluate_expression(&temp, line, &context);
-		if (evaluation.valid)
+	// only the rows that would come out different from last frame are drawn again
+	Render_Cache *render_cache = &state->render_cache;
+	u64 view = mix_signature(mix_signature(mix_signature(canvas->width, canvas->height), state->scroll_offset), horizontal_offset);
+	bool32 redraw_everything = canvas->contents_lost || view != render_cache->view;
+	render_cache->view = view;
+	canvas->contents_lost = false;
+	canvas->dirty_rect_count = 0;
+	if (redraw_everything)
+		add_dirty_rect(canvas, 0, canvas->height);
+
+	u64 row_count = canvas->height / font->line_height + 2;
+	for (u64 row = 0; row < row_count; ++row)
+	{
+		u64 i = min + row;
+		u64 signature = (i < state->document.line_count)? get_line_signature(state, i, copy_is_down) : 0;
+		bool32 row_changed = row >= array_count(render_cache->rows) || render_cache->rows[row] != signature;
+		if (row < array_count(render_cache->rows))
+			render_cache->rows[row] = signature;
+		if (row_changed && !redraw_everything)
 		{
-			UTF32_String result = convert_f64_to_string(&temp, evaluation.value);
-			u32 result_color = coloru8(0, 128);
-
-			if (i == state->cursor_line)
-			{
-				if (keyboard->copy.is_down)
-					result_color = coloru8(100, 100, 255, 200);
-				if (button_was_pressed(keyboard->copy))
-					platform->push_to_clipboard(result);
-			}
-
-			s32 result_width = get_text_width(&state->font, result);
-			draw_text(canvas, &state->font, result, canvas->width - result_width, baseline, result_color);
-
-			add_or_update_variable(&context, prev_var, evaluation.value);
-			add_or_update_variable(&context, sum_var, context[sum_var].value + evaluation.value);
+			s32 top = (s32)(font->line_height * i - state->scroll_offset);
+			add_dirty_rect(canvas, top, top + font->line_height);
 		}
 	}
 
@@ -567,14 +1357,53 @@ update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_
 	fps_history[fps_history_index++] = (s64)1e6 / time->delta;
 	fps_history_index %= array_count(fps_history);
 
-	s32 bar_width = canvas->width / array_count(fps_history);
 	s32 max_height = 0;
+	for (u64 i = 0; i < array_count(fps_history); ++i)
+		max_height = (s32)maximum(max_height, fps_history[i]);
+
+	// the overlays change every frame, and what they covered has to be put back
+	persistent s32 previous_overlay_top = 0;
+	s32 overlay_top = canvas->height - max_height - font->line_height;
+	add_dirty_rect(canvas, (s32)minimum(overlay_top, previous_overlay_top), canvas->height);
+	previous_overlay_top = overlay_top;
+	#if PROFILE
+		add_dirty_rect(canvas, 0, get_profile_overlay_height(font));
+	#endif
+#endif
+
+	for (u32 r = 0; r < canvas->dirty_rect_count; ++r)
+	{
+		// a view of just the band, so everything drawn is cut to it
+		Rect dirty = canvas->dirty_rects[r];
+		Canvas band = {};
+		band.buffer = canvas->buffer + dirty.min_y * canvas->width;
+		band.width  = canvas->width;
+		band.height = dirty.max_y - dirty.min_y;
+
+		// background
+		draw_rect(&band, horizontal_offset, 0, band.width, band.height, colorf32(1));
+		// line number sidebar
+		draw_rect(&band, 0, 0, horizontal_offset, band.height, colorf32(0.9f));
+
+		// and the lines on either side, in case their glyphs reach into it
+		u64 first = (dirty.min_y + state->scroll_offset) / font->line_height;
+		u64 last  = (dirty.max_y - 1 + state->scroll_offset) / font->line_height + 1;
+		first = maximum(first, min + 1) - 1;
+		last  = minimum(last + 1, max);
+		for (u64 i = first; i < last; i++)
+		{
+			s32 vertical_offset = (s32)(font->line_height * i - state->scroll_offset);
+			draw_line(&band, state, i, vertical_offset - dirty.min_y, copy_is_down, &temp);
+		}
+	}
+
+#if DEBUG
+	s32 bar_width = canvas->width / array_count(fps_history);
 	for (u64 i = 0; i < array_count(fps_history); ++i)
 	{
 		u64 it = (fps_history_index + i) % array_count(fps_history);
 		s64 fps_i = fps_history[it];
 		// fps_i /= 2;
-		max_height = (s32)maximum(max_height, fps_i);
 		draw_rect(canvas,
 			(s32)(bar_width * i      ), canvas->height - (s32)fps_i,
 			(s32)(bar_width * (i + 1)), canvas->height - (s32)fps_i + 1,
@@ -608,4 +1437,12 @@ update_and_render(Memory_Arena *arena, Platform *platform, Canvas *canvas, Time_
 		canvas->width - info_width, canvas->height - max_height - state->font.line_height + state->font.baseline,
 		colorf32(1, 0, 0));
 #endif
+
+#if PROFILE
+	end_profile_frame();
+	#if DEBUG
+		// not part of the frame it shows
+		draw_profile_overlay(canvas, &state->font, &temp);
+	#endif
+#endif
 }
\ No newline at end of file
@@ -3,25 +3,65 @@
 #include "memory_arena.h"
 #include "utf32_string.h"
 #include "math_evaluation.h"
+#include "profiler.h"
+#include "blend.h"
 
 struct Glyph {
-	u32 width;
+	u32 offset; // of its top left in the atlas
+	u16 width;
+	u16 height;
+	s16 x;
+	s16 y;
+	s16 advance;
+	u16 pinned; // in the pinned atlas rather than the cache
+};
+
+struct Glyph_Atlas
+{
+	// a cell of stride by cell_height bytes of coverage for every glyph slot, one after the other
+	u8 *pixels;
+	u32 stride;
 	u32 height;
-	s32 x;
-	s32 y;
-	u32 advance;
-	u8 *buffer;
+	u32 cell_height;
 };
 
+#define GLYPH_SLOT_COUNT 256
+#define GLYPH_SLOT_EMPTY 0xFFFFFFFF
+
+struct Font;
+typedef bool32 Font_Rasterize_Glyph(Font*, u32 codepoint, Glyph*, u8 *pixels, u32 stride); // false where the font has none
+
 struct Font
 {
 	u32 line_height;
 	u32 baseline;
 
-	u32 range_count;
-	u32 (*ranges)[2];
+	// glyphs are rasterized the first time they are looked up, into a slot of the atlas,
+	// taking the one used longest ago; slot 0 holds the box drawn where the font has none
+	Font_Rasterize_Glyph *rasterize_glyph;
+	void *rasterizer;
+
+	Glyph *glyphs;          // one for each slot
+	u32 *glyph_code_points; // in each slot, or GLYPH_SLOT_EMPTY
+	u64 *glyph_last_used;
+	u64 glyph_clock;
+	Glyph_Atlas atlas;
+
+	// the slot of each code point in the cache, 0 where it isn't: directly up to 255,
+	// above that from pages of 256 code points, page 0 being empty, taken and given back
+	// as code points come and go
+	u16 latin_glyphs[256];
+	u16 *glyph_pages_by_code_point; // code point >> 8 to the page
+	u16 (*glyph_pages)[256];
+	u16 *glyph_page_use; // how many code points on each page are in the cache
 
-	Glyph *glyphs;
+	// a bit per code point the font has no glyph for, so the box is drawn without asking again;
+	// apart from the pages, which only have room for as many code points as there are slots
+	u8 *missing_glyphs;
+
+	// glyphs rasterized ahead of time, from a font cache file, at slots GLYPH_SLOT_COUNT and up
+	Glyph *pinned_glyphs;
+	Glyph_Atlas pinned_atlas;
 };
 
 struct Document
@@ -32,6 +72,99 @@ struct Document
 	u32 line_capacity;
 };
 
+struct Cached_Variable
+{
+	// one for each of the program's slots
+	Result before; // as the line found it
+	Result after;  // as the line left it
+};
+
+struct Cached_Line
+{
+	bool32 dirty;
+	bool32 absorbed_lines; // what it wrote before no longer covers everything above the next line
+	u64    hash;
+	Result result;
+
+	// the implicit variables, as the line leaves them
+	Result prev;
+	Result sum;
+
+	// compiled once per text, stored in the line cache's program arena
+	Program program;
+	Cached_Variable *slots;
+
+	u32 result_length;
+	u32 result_text[64];
+};
+
+struct Variable_Changes
+{
+	Atom   atoms[32];
+	u32    count;
+	bool32 everything;
+};
+
+struct Defining_Lines
+{
+	// the lines that write an atom, in order
+	u32 *lines;
+	u32 count;
+	u32 capacity;
+};
+
+struct Line_Cache
+{
+	Cached_Line *lines;
+
+	// programs are compacted into the spare half when the active one fills up,
+	// and both grow into arena when what the lines use wouldn't leave room
+	Memory_Arena *arena;
+	Memory_Arena programs;
+	Memory_Arena spare;
+
+	u64 first_dirty_line;
+	u64 last_dirty_line;
+
+	// variables written by lines that were removed, taking effect from pending_line
+	Variable_Changes pending;
+	u64 pending_line;
+
+	// the document's identifiers, in the first arena; when that's half full, they're made again
+	// in the other from the ones the lines still use, so that what was typed on the way doesn't pile up
+	Atom_Table atoms;
+	Memory_Arena *identifiers;
+	Memory_Arena *spare_identifiers;
+
+	// by atom, for find_variable_before; grown with the atoms, in their arena
+	Defining_Lines *definitions;
+	u32 definition_count;
+};
+
+struct Render_Cache
+{
+	// what was drawn last frame, to tell what has to be drawn again
+	u64 view;      // the canvas size and scroll
+	u64 rows[256]; // a signature per row of the screen, 0 where blank
+};
+
+#define LAYOUT_CACHE_LINES 4
+
+struct Line_Layout
+{
+	u64 hash;     // of the text laid out, as the line cache has it
+	u64 length;
+	u64 last_used;
+	s32 *offsets; // where each character starts, and where the last one ends
+};
+
+struct Layout_Cache
+{
+	// the lines the caret and the mouse were on last
+	Line_Layout lines[LAYOUT_CACHE_LINES];
+	u64 clock;
+};
+
 struct State
 {
 	Font font;
@@ -42,10 +175,23 @@ struct State
 	u32 line_number_bar_width;
 
 	Document document;
+	Line_Cache line_cache;
+
 	u64 cursor_line;
 	u64 cursor_position_in_line;
 
 	u64 scroll_offset;
+
+	Render_Cache render_cache;
+	Layout_Cache layout_cache;
+};
+
+struct Rect
+{
+	s32 min_x;
+	s32 min_y;
+	s32 max_x;
+	s32 max_y;
 };
 
 struct Canvas
@@ -53,6 +199,12 @@ struct Canvas
 	u32 *buffer;
 	u32 width;
 	u32 height;
+
+	// set by the platform when the buffer is new, so that all of it is drawn
+	bool32 contents_lost;
+	// what the frame changed, for the platform to present
+	Rect dirty_rects[32];
+	u32  dirty_rect_count;
 };
 
 struct Input_Button
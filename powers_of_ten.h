@@ -0,0 +1,374 @@
+#pragma once
+#include "grs.h"
+
+/*
+	128-bit significands of powers of ten, for converting between f64 and decimal without
+	a big number. 10^k is the product of powers_of_ten_by_32[(k + 5024) / 32] and
+	powers_of_ten_by_1[(k + 5024) % 32], cut to its top 128 bits; each row is
+	{ high, low } of floor(10^k * 2^(127 - floor(log2 10^k))), the top bit set.
+	Going by 32s keeps the table small: 1e-5024 to 1e5023 covers every long double
+	(1e-4951 to 1e4932) with a 128-bit integer on either side of it.
+
+	Generated with Python, for each row of either table:
+		if k >= 0: t = 10**k >> (bits - 128) or << (128 - bits), bits = (10**k).bit_length()
+		else:      t = 2**(127 + (10**-k).bit_length()) // 10**-k
+	Checked for every k: the truncated product is at most 3 units below the true 10^k,
+	and exactly it for 0 <= k <= 55 (while 5^k fits in 128 bits).
+*/
+
+#define POWER_OF_TEN_MIN (-5024) // a multiple of 32
+#define POWER_OF_TEN_MAX 5023
+
+global const u64 powers_of_ten_by_32[][2] =
+{
+	{ 0xC6890560A980BD4E, 0x7187D0624136A30F }, // 1e-5024
+	{ 0xF4B6ACD4DF2955B1, 0xF27331DA557787EC }, // 1e-4992
+	{ 0x96D0FE91C0DFC76D, 0xF60BA283DB0DC635 }, // 1e-4960
+	{ 0xB9E5428330737362, 0xBDDB2DFDE3F8A6E3 }, // 1e-4928
+	{ 0xE5224AA15F397D98, 0x29608B2D0ACCDAC3 }, // 1e-4896
+	{ 0x8D36F6971766349C, 0xAC63454249B771C8 }, // 1e-4864
+	{ 0xAE0F80A2A8960B10, 0x7AEB29F92ABEB4CA }, // 1e-4832
+	{ 0xD68BD3C92066A797, 0x326CB526B3747638 }, // 1e-4800
+	{ 0x84396C05C0EEBC9D, 0xFE110A64E32DD81B }, // 1e-4768
+	{ 0xA2FAA242A3BD093C, 0xC62364C260A887E2 }, // 1e-4736
+	{ 0xC8E31DE056F89C19, 0x0915564D8AB057EE }, // 1e-4704
+	{ 0xF79CD0BC0A9865E1, 0xA6246CC005E1B086 }, // 1e-4672
+	{ 0x989A5FA7953007A7, 0x4574B3F93355188B }, // 1e-4640
+	{ 0xBC1905F3E898CCA2, 0x41A8BCD577F7A7D8 }, // 1e-4608
+	{ 0xE7D92F014768E772, 0x62EAE6F47049FC2F }, // 1e-4576
+	{ 0x8EE3393B07698E29, 0x62648D93CDF05BA2 }, // 1e-4544
+	{ 0xB01F5FC35203ED1B, 0x78E2AAD3DDD1E309 }, // 1e-4512
+	{ 0xD9167AB0C1965798, 0xA8EDFFDCCFE4DB4B }, // 1e-4480
+	{ 0x85CA6ACD9D3E7DAF, 0xDCF0FB000A652614 }, // 1e-4448
+	{ 0xA4E8E60BEEC08B8F, 0xD49596808F0F2914 }, // 1e-4416
+	{ 0xCB44585821C722EC, 0xEC6EC617F2819A18 }, // 1e-4384
+	{ 0xFA8BBF517F29408A, 0x31C0368CCB2C5757 }, // 1e-4352
+	{ 0x9A692BD43B368FC3, 0x8389C148C919653A }, // 1e-4320
+	{ 0xBE53771CC8F1B8BB, 0x6C682809BA47FF0E }, // 1e-4288
+	{ 0xEA984EC57DE69F13, 0x66E849253E5DA0C2 }, // 1e-4256
+	{ 0x90948EA6C52E5802, 0xD6960685C12CD7C1 }, // 1e-4224
+	{ 0xB2357FC2D76029B7, 0xAEAD36C237CBF749 }, // 1e-4192
+	{ 0xDBA8D6D20F6B5894, 0xF0FC278B7F968212 }, // 1e-4160
+	{ 0x876029AD8859B2FD, 0x54ACA7F5709CB082 }, // 1e-4128
+	{ 0xA6DD04C8D2CE9FDE, 0x2DE38123A1C3CFFC }, // 1e-4096
+	{ 0xCDACCA69A2D4C45A, 0x96EDA1512F2FC323 }, // 1e-4064
+	{ 0xFD83933EDA772C0B, 0x5052E9289F0F2333 }, // 1e-4032
+	{ 0x9C3D73864F3805C0, 0x24B99688D11E41BC }, // 1e-4000
+	{ 0xC094AA3EDDB202E4, 0x1A096FC7358788C3 }, // 1e-3968
+	{ 0xED5FC2E513417A2F, 0xBA641FE889DFD27B }, // 1e-3936
+	{ 0x924B063D1CEB45B3, 0x1436A2DAD831490D }, // 1e-3904
+	{ 0xB451F3982A13E433, 0x73E14BC8E5EDD724 }, // 1e-3872
+	{ 0xDE42FF8D37CAD87F, 0x1463EF488D5226CB }, // 1e-3840
+	{ 0x88FAB70D8B44952A, 0x3F1F93F1943CA9B6 }, // 1e-3808
+	{ 0xA8D7103B2A9FDDBF, 0x2409AC6534C33030 }, // 1e-3776
+	{ 0xD01C89F80CD9E07E, 0x437ABD5769E5212F }, // 1e-3744
+	{ 0x804233BF4B0B191C, 0x752CD52FAFAF4AF1 }, // 1e-3712
+	{ 0x9E17475E42D0BFAC, 0x759A4EADDDC5DB0C }, // 1e-3680
+	{ 0xC2DCB3D89FB0F90E, 0x75AF8412A0D013FC }, // 1e-3648
+	{ 0xF02FA4A2CE256606, 0x7F437695D5CCDBE0 }, // 1e-3616
+	{ 0x9406AF8F83FD6265, 0x4B4DE34E0EBC3E06 }, // 1e-3584
+	{ 0xB674CE73BF10EA47, 0x4FE1E9B0FCDF7B3D }, // 1e-3552
+	{ 0xE0E50C894CC21DFD, 0x81884DD8CB5EB34A }, // 1e-3520
+	{ 0x8A9A21815FAD9D9C, 0x576C105A49A6F1AD }, // 1e-3488
+	{ 0xAAD71A5AAB16DC6C, 0x5086FDECF2F641C6 }, // 1e-3456
+	{ 0xD293AD28F3512F42, 0x09CD28999C147C35 }, // 1e-3424
+	{ 0x81C72BAE7E65DAD8, 0x5E580222F2F811AE }, // 1e-3392
+	{ 0x9FF6B82EF415D222, 0x60DBD8AA443B560F }, // 1e-3360
+	{ 0xC52BA8A6AEB15D92, 0x9E98CB984F0D3050 }, // 1e-3328
+	{ 0xF3080D8E10F7553F, 0x71E6A2E9BBBF5A4B }, // 1e-3296
+	{ 0x95C79A5EA669FE86, 0x3615915D6DF7666F }, // 1e-3264
+	{ 0xB89E23C03D3D9B7F, 0xF4D741C050AAA631 }, // 1e-3232
+	{ 0xE38F15B51B8440F7, 0x31EA85E808DEBA7F }, // 1e-3200
+	{ 0x8C3E77C8F46D23BF, 0x7FEF20156B676076 }, // 1e-3168
+	{ 0xACDD3555869159D1, 0xEC41C1793D69D0D1 }, // 1e-3136
+	{ 0xD5124A6513C582C0, 0x4A1CCB32D5C21BF6 }, // 1e-3104
+	{ 0x8350BF3C91575A87, 0xE79E236BF8BF47A8 }, // 1e-3072
+	{ 0xA1DBD6FE468072A2, 0xBDE5E7AAB8410244 }, // 1e-3040
+	{ 0xC7819DA48DDE4790, 0x4E6570CD8536B61F }, // 1e-3008
+	{ 0xF5E91783C229830C, 0x7087CECF10E2B5A5 }, // 1e-2976
+	{ 0x978DD69AF60DC360, 0xE1E20CFD1289138C }, // 1e-2944
+	{ 0xBACE07232DF1C802, 0x7C4C65D15C614C56 }, // 1e-2912
+	{ 0xE641334805F3E36F, 0xDB67CF7BBBAC365A }, // 1e-2880
+	{ 0x8DE7C8D0F396CDF1, 0x071D3350FF673295 }, // 1e-2848
+	{ 0xAEE973911228ABCA, 0xE3187C34500D9AB3 }, // 1e-2816
+	{ 0xD798785921820787, 0xD94D2137A3A6F4F4 }, // 1e-2784
+	{ 0x84DEFC62F01C45B0, 0x67AC7C1D9CCD8266 }, // 1e-2752
+	{ 0xA3C6B505BDA91BCC, 0x52D9655BDF62F25C }, // 1e-2720
+	{ 0xC9DEA80D6283A34C, 0x474B3CB1FE1D6A7F }, // 1e-2688
+	{ 0xF8D2DCAF37504B51, 0x9492DB3D978AACA8 }, // 1e-2656
+	{ 0x995974653B7E0231, 0x212DA7006DC4E43B }, // 1e-2624
+	{ 0xBD048C7DAF8ACADB, 0x9736B4514993E0BA }, // 1e-2592
+	{ 0xE8FB7DC2DEC0A404, 0x598EEC7D41754C09 }, // 1e-2560
+	{ 0x8F9623B34A2198AF, 0x8CE3C290DF62726A }, // 1e-2528
+	{ 0xB0FBE7AA6CE75997, 0xF73CBDE9FEBC8FCE }, // 1e-2496
+	{ 0xDA264DF693AC3E30, 0x742AB8F3864562C8 }, // 1e-2464
+	{ 0x8671F14568278BEA, 0x138204EA625927F7 }, // 1e-2432
+	{ 0xA5B763B319D7F1DC, 0x0A0F429D93058121 }, // 1e-2400
+	{ 0xCC42DD5CB5091819, 0x1D8106CCF8EE85B4 }, // 1e-2368
+	{ 0xFBC5778B22FFF09B, 0x3781BF4A97122FBC }, // 1e-2336
+	{ 0x9B2A840F28A1638F, 0xE393A9C032FB0C34 }, // 1e-2304
+	{ 0xBF41C7ED2A1D370B, 0x65DE36DC36A40A10 }, // 1e-2272
+	{ 0xEBBE0DF0C8201AC5, 0x131565BE33DDA91A }, // 1e-2240
+	{ 0x914997B7B12B451C, 0xD902EF9EA5BAF811 }, // 1e-2208
+	{ 0xB314A47728F9CD6C, 0x9063016130392DF7 }, // 1e-2176
+	{ 0xDCBBE27475CEFF9C, 0xD18F7AECE789392B }, // 1e-2144
+	{ 0x8809AC32A8A8A8ED, 0xBAE63E54A2044DDD }, // 1e-2112
+	{ 0xA7ADF4A8F66FF68E, 0x205C4FAF4EDD7B60 }, // 1e-2080
+	{ 0xCEAE534F34362DE4, 0x492512D4F2EAD2CB }, // 1e-2048
+	{ 0xFEC102E2857BC1F9, 0x6C656C3B1F2C9D91 }, // 1e-2016
+	{ 0x9D01161BED052BB7, 0x699B5F371124CF4F }, // 1e-1984
+	{ 0xC185CDCC064A81BA, 0x50E167BA79E975E1 }, // 1e-1952
+	{ 0xEE88FCE8152A48DF, 0xBFE3C33C58668242 }, // 1e-1920
+	{ 0x9302345438DC0E7A, 0x69852CC6A07D2F0C }, // 1e-1888
+	{ 0xB533BD05F6E01FED, 0x11800AF4BC788512 }, // 1e-1856
+	{ 0xDF594D503ADDF379, 0x007A33E8D271B7CA }, // 1e-1824
+	{ 0x89A63BA4C497B50E, 0x6C83AD1260FF20F4 }, // 1e-1792
+	{ 0xA9AA79BF6A3AAC53, 0xDDCCE19614FB7834 }, // 1e-1760
+	{ 0xD1211FE37AC6A148, 0x0FC4EAFEDD191926 }, // 1e-1728
+	{ 0x80E2CCE8D01F963A, 0xB5A21AF135506167 }, // 1e-1696
+	{ 0x9EDD3B40CBF457E6, 0x52FFA3F3ADCDF125 }, // 1e-1664
+	{ 0xC3D0B2B266412778, 0x322B56A3F15DC601 }, // 1e-1632
+	{ 0xF15C640B2DE17B85, 0x75D9B3727E6E5A47 }, // 1e-1600
+	{ 0x94C0092DD4EF9511, 0x43CF71D5C4FD7868 }, // 1e-1568
+	{ 0xB759449F52A711B2, 0x68E1EB75340122D4 }, // 1e-1536
+	{ 0xE1FEA64E92B8F6F8, 0x621601D613047373 }, // 1e-1504
+	{ 0x8B47AE41B64BDA30, 0x1754B16BEBA6AAD6 }, // 1e-1472
+	{ 0xABAD0504A999D9E0, 0x5770075139D01FF3 }, // 1e-1440
+	{ 0xD39B595AD755EA09, 0x7B5B520AA67D2087 }, // 1e-1408
+	{ 0x8269ABE37634AEE0, 0x0655AF3873EEE5A6 }, // 1e-1376
+	{ 0xA0BF0465B455E921, 0x6E1F7F1642EBAAC8 }, // 1e-1344
+	{ 0xC6228B76E0EDDE17, 0x14037E4FB249456B }, // 1e-1312
+	{ 0xF4385D0975EDBABE, 0x1F4BF6653CD3B977 }, // 1e-1280
+	{ 0x96832618EAE7FBEA, 0x2913574E1B92C759 }, // 1e-1248
+	{ 0xB9854EC6332E5955, 0xA7890845B98CDE15 }, // 1e-1216
+	{ 0xE4AC057C4237088F, 0x4C7284F9EDDA793D }, // 1e-1184
+	{ 0x8CEE12DBE4A0D94D, 0x1668CD8FAD294D80 }, // 1e-1152
+	{ 0xADB5A8BDAAA53051, 0x61363686961A41E5 }, // 1e-1120
+	{ 0xD61D163A16A90D2F, 0xFF2F89082E46B1AE }, // 1e-1088
+	{ 0x83F52C420A0A1BF8, 0xD6E5A8DC8BD7642D }, // 1e-1056
+	{ 0xA2A682A5DA57C0BD, 0x87A601586BD3F698 }, // 1e-1024
+	{ 0xC87B6D2F3F64789E, 0x7855B18AC87D35CC }, // 1e-992
+	{ 0xF71D01E03613F568, 0x52E84DE3B97F1642 }, // 1e-960
+	{ 0x984B9B19E1F045DD, 0x402596199721B820 }, // 1e-928
+	{ 0xBBB7EF38BB827F2D, 0x6D4AA5B50BB5DC0D }, // 1e-896
+	{ 0xE761832EFDC06462, 0x07CD71A4AD11C394 }, // 1e-864
+	{ 0x8E997872A9B05AC7, 0xE31578D4E269D267 }, // 1e-832
+	{ 0xAFC47766CB39A7B0, 0xD7BE2621598B9454 }, // 1e-800
+	{ 0xD8A66D4A505DE96B, 0x5AE1B25946117390 }, // 1e-768
+	{ 0x85855C0F774FB85E, 0x4B48B0E153CDCE9A }, // 1e-736
+	{ 0xA493C75052EB8374, 0xD521D9ABBFEB2FED }, // 1e-704
+	{ 0xCADB6D313C8736FC, 0x2FFFF1289A804C5A }, // 1e-672
+	{ 0xFA0A6CDB8871347C, 0xD04EE5EFC60D3E49 }, // 1e-640
+	{ 0x9A197865B4730DD0, 0x1C6B313713A077E7 }, // 1e-608
+	{ 0xBDF139F0EE5092C6, 0x8904F03C4C1D014A }, // 1e-576
+	{ 0xEA1F3806467F9466, 0x36C30D4BCE887FE1 }, // 1e-544
+	{ 0x9049EE32DB23D21C, 0x7132D332E3F204D4 }, // 1e-512
+	{ 0xB1D983B479007736, 0x61EB52E27BA1A893 }, // 1e-480
+	{ 0xDB377599B6074244, 0x84C663CEE6B86E7C }, // 1e-448
+	{ 0x871A49813FFC68A6, 0x1A4EB006F7CE07DE }, // 1e-416
+	{ 0xA686E3E8B11B0857, 0x88DB9FFFD5E6810E }, // 1e-384
+	{ 0xCD42A11346F34F7D, 0x0092757BF2623727 }, // 1e-352
+	{ 0xFD00B897478238D0, 0x8920B098955522B4 }, // 1e-320
+	{ 0x9BECCE62836AC577, 0x4EE367F9430AEC32 }, // 1e-288
+	{ 0xC0314325637A1939, 0xFA911155FEFB5308 }, // 1e-256
+	{ 0xECE53CEC4A314EBD, 0xA4F8BF5635246428 }, // 1e-224
+	{ 0x91FF83775423CC06, 0x7B6306A34627DDCF }, // 1e-192
+	{ 0xB3F4E093DB73A093, 0x59ED216765690F56 }, // 1e-160
+	{ 0xDDD0467C64BCE4A0, 0xAC7CB3F6D05DDBDE }, // 1e-128
+	{ 0x88B402F7FD75539B, 0x11DBCB0218EBB414 }, // 1e-96
+	{ 0xA87FEA27A539E9A5, 0x3F2398D747B36224 }, // 1e-64
+	{ 0xCFB11EAD453994BA, 0x67DE18EDA5814AF2 }, // 1e-32
+	{ 0x8000000000000000, 0x0000000000000000 }, // 1e0
+	{ 0x9DC5ADA82B70B59D, 0xF020000000000000 }, // 1e32
+	{ 0xC2781F49FFCFA6D5, 0x3CBF6B71C76B25FB }, // 1e64
+	{ 0xEFB3AB16C59B14A2, 0xC5CFE94EF3EA101E }, // 1e96
+	{ 0x93BA47C980E98CDF, 0xC66F336C36B10137 }, // 1e128
+	{ 0xB616A12B7FE617AA, 0x577B986B314D6009 }, // 1e160
+	{ 0xE070F78D3927556A, 0x85BBE253F47B1417 }, // 1e192
+	{ 0x8A5296FFE33CC92F, 0x82BD6B70D99AAA6F }, // 1e224
+	{ 0xAA7EEBFB9DF9DE8D, 0xDDBB901B98FEEAB7 }, // 1e256
+	{ 0xD226FC195C6A2F8C, 0x73832EEC6FFF3111 }, // 1e288
+	{ 0x81842F29F2CCE375, 0xE6A1158300D46640 }, // 1e320
+	{ 0x9FA42700DB900AD2, 0x5EBF18B6D27795FF }, // 1e352
+	{ 0xC4C5E310AEF8AA17, 0x1027FFF56784F444 }, // 1e384
+	{ 0xF28A9C07E9B09C58, 0xB5E54F71127AD372 }, // 1e416
+	{ 0x957A4AE1EBF7F3D3, 0xA7EA9C8838CE9437 }, // 1e448
+	{ 0xB83ED8DC0795A262, 0x7DF40A744E446163 }, // 1e480
+	{ 0xE319A0AEA60E91C6, 0xCC655C54BC5058F8 }, // 1e512
+	{ 0x8BF61451432D7BC2, 0xC80CFF6EC76DDE09 }, // 1e544
+	{ 0xAC83FB896B6795FC, 0xC6EBCEFF061B64C5 }, // 1e576
+	{ 0xD4A44FB4B8FA79AF, 0x9D3C1B8618251F10 }, // 1e608
+	{ 0x830CF791E54A9D1C, 0x96E4AC8AE2F0A61D }, // 1e640
+	{ 0xA1884B69ADE24964, 0x55E04DBA4B3BD4DD }, // 1e672
+	{ 0xC71AA36A1F8F01CB, 0x9DAD43F230E1226E }, // 1e704
+	{ 0xF56A298F437028F3, 0x31A0A1F380BA36EE }, // 1e736
+	{ 0x973F9CA8CD00A68C, 0x6C8D3FCA02CA6DE6 }, // 1e768
+	{ 0xBA6D9B40D7CC9ECC, 0xDF143BBE46291876 }, // 1e800
+	{ 0xE5CA5A0B8D737F0E, 0x23114665ACC60D3B }, // 1e832
+	{ 0x8D9E89D11346BDA5, 0x7E289E1EABE77166 }, // 1e864
+	{ 0xAE8F2B2CE3D5DBE9, 0x870A8D87239D8F35 }, // 1e896
+	{ 0xD72930205A0C1B2F, 0xAAE8C1D6C83415A0 }, // 1e928
+	{ 0x849A672A0D2ECFD1, 0xC832A5685E79350C }, // 1e960
+	{ 0xA3722C1341FA93DE, 0x13FE73C71DDF07EF }, // 1e992
+	{ 0xC976758681750C17, 0x650D3D28F18B50CE }, // 1e1024
+	{ 0xF8526DCAA67E0B77, 0x8686AD2B30C2D961 }, // 1e1056
+	{ 0x990A4D36997A9834, 0x1EAC5B7D1142D87C }, // 1e1088
+	{ 0xBCA2FC30CC19F090, 0x9EB5CB19647508C5 }, // 1e1120
+	{ 0xE8833C181C3BBFE0, 0xDC18D6CE622438A3 }, // 1e1152
+	{ 0x8F4C0691750E8305, 0x0A40DE037C9AD730 }, // 1e1184
+	{ 0xB0A08D798ABCE436, 0x026B8897E82CDE8D }, // 1e1216
+	{ 0xD9B5B441DF1CA24A, 0x75BD95CF6D4E57F9 }, // 1e1248
+	{ 0x862C8C0EEB856ECB, 0x085BCCD5C05EE9F9 }, // 1e1280
+	{ 0xA561DA6259253F91, 0x202E275E2E6472B2 }, // 1e1312
+	{ 0xCBD96ED6466CF081, 0xBEB7FBDC1CBE8B37 }, // 1e1344
+	{ 0xFB4383271A87A1CE, 0xECA608D886D5085F }, // 1e1376
+	{ 0x9ADA6CD496EF0E05, 0x2F1A208FDEDFF747 }, // 1e1408
+	{ 0xBEDF0FBEEAA56989, 0xB77CAF58B4A564E0 }, // 1e1440
+	{ 0xEB445F92A877BB09, 0xBC921B2C3EB25C7B }, // 1e1472
+	{ 0x90FE99D23E8DF6CF, 0x4EC0AAEB679E4D79 }, // 1e1504
+	{ 0xB2B8353B3993A7E4, 0x4257AC3B4C1D7794 }, // 1e1536
+	{ 0xDC49F3445824E360, 0xFB0B98F6BBC4F0CB }, // 1e1568
+	{ 0x87C37487CCF4B0BF, 0x532430E7002ACA8E }, // 1e1600
+	{ 0xA75767F07481436F, 0xE75DD664B8F76AA1 }, // 1e1632
+	{ 0xCE43A50AE4F7FB8E, 0x7877892520EE1715 }, // 1e1664
+	{ 0xFE3D8461CB764145, 0xD440A4FF74D6AF6A }, // 1e1696
+	{ 0x9CB00BFD6F025339, 0x2E61AA868501E740 }, // 1e1728
+	{ 0xC121EA3B1AA714B6, 0xF84DF185FC7D1BFD }, // 1e1760
+	{ 0xEE0DDD84924AB88C, 0x2D4070F33B21AB7B }, // 1e1792
+	{ 0x92B6530184ED7FB3, 0x555C13432402E523 }, // 1e1824
+	{ 0xB4D63576CAA95365, 0xF33CE3D6F17B62D1 }, // 1e1856
+	{ 0xDEE60499182F84B2, 0xF9D2E9FD2F16711F }, // 1e1888
+	{ 0x895F2F074B86004C, 0xBC3BC2377649DEEF }, // 1e1920
+	{ 0xA952E68C74F91E40, 0x83F904625BF851B2 }, // 1e1952
+	{ 0xD0B52E179D84F732, 0xFC8EA8820C829FE6 }, // 1e1984
+	{ 0x80A046447E3D49F1, 0xB7B1ADA9CDEBA84D }, // 1e2016
+	{ 0x9E8B3B5DC53D5DE4, 0xA74D28CE329ACE52 }, // 1e2048
+	{ 0xC36BA032DD07DDFE, 0xBD05B64FEB6D2FFF }, // 1e2080
+	{ 0xF0DFCF43277D1129, 0x6E2CB3E7E6C76433 }, // 1e2112
+	{ 0x947341BC28B52123, 0xD9DF435D26C85DD5 }, // 1e2144
+	{ 0xB6FAA16AC604D6F6, 0x180F7FCDF9F88B9D }, // 1e2176
+	{ 0xE189FFF88A6E300A, 0x6C0854DEE9FE3499 }, // 1e2208
+	{ 0x8AFFCA2BD1F88549, 0x1E34291B1EF566C7 }, // 1e2240
+	{ 0xAB54683B3D20E23B, 0x212BBB6587CE8D13 }, // 1e2272
+	{ 0xD32E203241F4806F, 0x3F50C802040F4CCC }, // 1e2304
+	{ 0x82265B7E7EFC84E0, 0xFFE39290A06447D6 }, // 1e2336
+	{ 0xA06C0BD4CE9DB63F, 0xD51AF6A3244A6983 }, // 1e2368
+	{ 0xC5BC4672073224F7, 0xB2C46D6D298A0658 }, // 1e2400
+	{ 0xF3BA4E7089C084E0, 0x17F49ABD213C38B8 }, // 1e2432
+	{ 0x963575CE63B6332D, 0x7EFA7D29C44E11B7 }, // 1e2464
+	{ 0xB9258C901050BC53, 0x0C1BEB6383DD861C }, // 1e2496
+	{ 0xE435FD6309D4FB29, 0x2CDA83AE165BF80E }, // 1e2528
+	{ 0x8CA554C020A1F0A6, 0x5DFED09922680A06 }, // 1e2560
+	{ 0xAD5BFF3854FF2560, 0x2AB1AA038B8D63A1 }, // 1e2592
+	{ 0xD5AE91D3FF7A6F8E, 0x1E914685A756A7D6 }, // 1e2624
+	{ 0x83B10FB893300CDE, 0x111AE5735EC0E878 }, // 1e2656
+	{ 0xA2528E74EAF101FC, 0xF09E780BCC8238D9 }, // 1e2688
+	{ 0xC813F2038018DCC4, 0x5BE12541BD907F81 }, // 1e2720
+	{ 0xF69D74FC97AEE56A, 0x5E0A5C3957F5DBB8 }, // 1e2752
+	{ 0x97FCFF3458A37B0C, 0x97ECAC7332C473B4 }, // 1e2784
+	{ 0xBB570A9A9BD977CC, 0x4C808753BB22FEF8 }, // 1e2816
+	{ 0xE6EA1521BB43AEBC, 0xE471D787C5786319 }, // 1e2848
+	{ 0x8E4FDDBBD3E242B6, 0xD1445B3F1CC9A09C }, // 1e2880
+	{ 0xAF69BDF68FC6A740, 0x7730E00421DA4D55 }, // 1e2912
+	{ 0xD83699BA2AE37E0C, 0xB1A05A0D64A2E6E8 }, // 1e2944
+	{ 0x854070F666F8939F, 0x2FCF6C219D9E0E06 }, // 1e2976
+	{ 0xA43ED4844001A59E, 0xBA5DA243711D4F39 }, // 1e3008
+	{ 0xCA72B831FF7BEF2D, 0xB5CEAF53C9875F4B }, // 1e3040
+	{ 0xF9895D25D88B5A8A, 0xFDD08C4DA13655EC }, // 1e3072
+	{ 0x99C9EE1AA45CBDB6, 0x605990407CF18034 }, // 1e3104
+	{ 0xBD8F2F7A1BA47D6D, 0x566765461BD2F61B }, // 1e3136
+	{ 0xE9A65FC76A44AAD4, 0xAE2C6960D0C96141 }, // 1e3168
+	{ 0x8FFF7443EC2F51ED, 0x36FF0AD5E3A835B0 }, // 1e3200
+	{ 0xB17DB720B3868E94, 0x7407CB9251918021 }, // 1e3232
+	{ 0xDAC64EE70F466AE5, 0x032727C1CCEF13BA }, // 1e3264
+	{ 0x86D48D6626C27EEB, 0xD4E1E0F5D911BD40 }, // 1e3296
+	{ 0xA630EF7D5699FE45, 0x50E3660235410F98 }, // 1e3328
+	{ 0xCCD8AE88CF70AD84, 0x12E29F09D9061609 }, // 1e3360
+	{ 0xFC7E217A6ACE9F0F, 0x7119AA2C0C5EE694 }, // 1e3392
+	{ 0x9B9C52DEF0F2F4FF, 0xC1AFEB8941B07AE6 }, // 1e3424
+	{ 0xBFCE0F5AB8A6761D, 0xDA1276A2F5DEBC0B }, // 1e3456
+	{ 0xEC6AF63168693F51, 0xB33C91DED66FF3B9 }, // 1e3488
+	{ 0x91B427AB57BCE6AD, 0xF739F1CA6F8AE61E }, // 1e3520
+	{ 0xB397FD9A22D732D7, 0xAE7EDAA76FBBD922 }, // 1e3552
+	{ 0xDD5DC8A2BF27F3F7, 0x95AA118EC1D08317 }, // 1e3584
+	{ 0x886D7361002A7720, 0x04B7EF7FAA32153C }, // 1e3616
+	{ 0xA828F10FB963C71C, 0xE012EB55F30D3C0A }, // 1e3648
+	{ 0xCF45EAD490352E65, 0xA3F2E2617152417C }, // 1e3680
+	{ 0xFF7BDCD8F586AED0, 0xBB2215057A199356 }, // 1e3712
+	{ 0x9D743E108A6A5FB0, 0xEFD29F06B8EB7BA2 }, // 1e3744
+	{ 0xC213BEA5C91F03D8, 0x421DDC40535F78B3 }, // 1e3776
+	{ 0xEF37F1886F4B6690, 0xF659EDE2159A45EC }, // 1e3808
+	{ 0x936E07737DC64F6D, 0x8C474BB609F40287 }, // 1e3840
+	{ 0xB5B8A47F8889782C, 0x89ABF129AF845214 }, // 1e3872
+	{ 0xDFFD1E7BE8191190, 0xAFB619B59AB7CAB9 }, // 1e3904
+	{ 0x8A0B316BA468D9FD, 0xCE808CD18E336B0C }, // 1e3936
+	{ 0xAA26EB2095A94E81, 0xE0280DBEA779D3B9 }, // 1e3968
+	{ 0xD1BA8323FE558C61, 0x0D5C82A286614F3E }, // 1e4000
+	{ 0x81415538CE493BD5, 0xF22E502FCDD4BCA2 }, // 1e4032
+	{ 0x9F51C070F53FB4A9, 0xC3720171212FDA8F }, // 1e4064
+	{ 0xC46052028A20979A, 0xC94C153F804A4A92 }, // 1e4096
+	{ 0xF20D6B41853CE899, 0xA5F1001D0CB47329 }, // 1e4128
+	{ 0x952D234CCB7E5F2A, 0x92506FD4D86244D3 }, // 1e4160
+	{ 0xB7DFBF27855ED611, 0x26289E8E9E6FCE92 }, // 1e4192
+	{ 0xE2A46848A8D6F78B, 0x88111764983EDBA9 }, // 1e4224
+	{ 0x8BADD636CC48B341, 0x0879B2E5F6EE8B1C }, // 1e4256
+	{ 0xAC2AEFCB5DFE300A, 0x0AEBC0915F75C1F2 }, // 1e4288
+	{ 0xD4368DC8BB2A0E80, 0x75A77A3B0BC28F4D }, // 1e4320
+	{ 0x82C952E37BE11CB4, 0x6E6C12AA02B9A1EC }, // 1e4352
+	{ 0xA134EAF486B5D13F, 0x578D95D780E47D84 }, // 1e4384
+	{ 0xC6B3DE56DB4AEF75, 0xC11B18BD25918C30 }, // 1e4416
+	{ 0xF4EB7D1EE4AC0571, 0x538966169D821439 }, // 1e4448
+	{ 0x96F18B1742AAD751, 0x888C9AB2FC5B3437 }, // 1e4480
+	{ 0xBA0D61235FD033EB, 0x1F1545846AAE50EE }, // 1e4512
+	{ 0xE553BE2769F4765E, 0xD15E6695E9FB0B3E }, // 1e4544
+	{ 0x8D55709FBDAEEA74, 0x7ABCD7ED54A929D3 }, // 1e4576
+	{ 0xAE3511626ED559F0, 0x7EF5F8C1B3A0771C }, // 1e4608
+	{ 0xD6BA215817B5591F, 0x814A69258DDD6D5A }, // 1e4640
+	{ 0x8455F5578672AD69, 0x796ECF6ADFC25225 }, // 1e4672
+	{ 0xA31DCEC2FEF14B30, 0xA28A151725A55E10 }, // 1e4704
+	{ 0xC90E78C7FCBEE713, 0xF3BE171A27BF81DA }, // 1e4736
+	{ 0xF7D24130E645DDD7, 0x462A2BF67DDFA64B }, // 1e4768
+	{ 0x98BB4EE309F04D45, 0x5A050B215EEBC516 }, // 1e4800
+	{ 0xBC419E3FB5E9D924, 0x6ECC7F9959C7582A }, // 1e4832
+	{ 0xE80B387FB9146D6C, 0xA6A99EE15AFEDE53 }, // 1e4864
+	{ 0x8F020FB0D2B663BD, 0x5D9F64C557CE815D }, // 1e4896
+	{ 0xB045626FB50A35E7, 0x58F8FDE02C03A6C6 }, // 1e4928
+	{ 0xD94554ABE1E9DB05, 0x68FC787A6F5F923F }, // 1e4960
+	{ 0x85E74AAA26674A71, 0x215ABDF4A82D15A6 }, // 1e4992
+};
+
+global const u64 powers_of_ten_by_1[][2] =
+{
+	{ 0x8000000000000000, 0x0000000000000000 }, // 1e0
+	{ 0xA000000000000000, 0x0000000000000000 }, // 1e1
+	{ 0xC800000000000000, 0x0000000000000000 }, // 1e2
+	{ 0xFA00000000000000, 0x0000000000000000 }, // 1e3
+	{ 0x9C40000000000000, 0x0000000000000000 }, // 1e4
+	{ 0xC350000000000000, 0x0000000000000000 }, // 1e5
+	{ 0xF424000000000000, 0x0000000000000000 }, // 1e6
+	{ 0x9896800000000000, 0x0000000000000000 }, // 1e7
+	{ 0xBEBC200000000000, 0x0000000000000000 }, // 1e8
+	{ 0xEE6B280000000000, 0x0000000000000000 }, // 1e9
+	{ 0x9502F90000000000, 0x0000000000000000 }, // 1e10
+	{ 0xBA43B74000000000, 0x0000000000000000 }, // 1e11
+	{ 0xE8D4A51000000000, 0x0000000000000000 }, // 1e12
+	{ 0x9184E72A00000000, 0x0000000000000000 }, // 1e13
+	{ 0xB5E620F480000000, 0x0000000000000000 }, // 1e14
+	{ 0xE35FA931A0000000, 0x0000000000000000 }, // 1e15
+	{ 0x8E1BC9BF04000000, 0x0000000000000000 }, // 1e16
+	{ 0xB1A2BC2EC5000000, 0x0000000000000000 }, // 1e17
+	{ 0xDE0B6B3A76400000, 0x0000000000000000 }, // 1e18
+	{ 0x8AC7230489E80000, 0x0000000000000000 }, // 1e19
+	{ 0xAD78EBC5AC620000, 0x0000000000000000 }, // 1e20
+	{ 0xD8D726B7177A8000, 0x0000000000000000 }, // 1e21
+	{ 0x878678326EAC9000, 0x0000000000000000 }, // 1e22
+	{ 0xA968163F0A57B400, 0x0000000000000000 }, // 1e23
+	{ 0xD3C21BCECCEDA100, 0x0000000000000000 }, // 1e24
+	{ 0x84595161401484A0, 0x0000000000000000 }, // 1e25
+	{ 0xA56FA5B99019A5C8, 0x0000000000000000 }, // 1e26
+	{ 0xCECB8F27F4200F3A, 0x0000000000000000 }, // 1e27
+	{ 0x813F3978F8940984, 0x4000000000000000 }, // 1e28
+	{ 0xA18F07D736B90BE5, 0x5000000000000000 }, // 1e29
+	{ 0xC9F2C9CD04674EDE, 0xA400000000000000 }, // 1e30
+	{ 0xFC6F7C4045812296, 0x4D00000000000000 }, // 1e31
+};
@@ -0,0 +1,273 @@
+#pragma once
+#include "grs.h"
+#include "memory_arena.h"
+#include "utf32_string.h"
+
+#include <time.h>
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#else
+	#include <x86intrin.h>
+#endif
+
+/*
+	Frame profiler. Compiled in with PROFILE, which DEBUG turns on.
+
+	profile_block(stage) times the rest of its scope with the cycle counter, into a ring
+	of events. Every frame adds up its events by stage (blocks inside blocks count for
+	both), which is what the overlay takes percentiles of, and the last frames can be
+	written out as Chrome trace events, for chrome://tracing or ui.perfetto.dev.
+	Cycles are turned into microseconds by comparing the counter to the wall clock
+	since the first frame.
+*/
+
+#if defined(DEBUG) && !defined(PROFILE)
+	#define PROFILE 1
+#endif
+
+enum Profile_Stage : u16
+{
+	Profile_Frame,
+	Profile_Input,
+	Profile_Recalculate_Lines,
+	Profile_Evaluate_Document,
+	Profile_Evaluate_Line,
+	Profile_Format_Result,
+	Profile_Draw_Text,
+	Profile_Rasterize_Glyph,
+	Profile_Fill,
+
+	Profile_Stage_Count
+};
+
+global char *profile_stage_names[Profile_Stage_Count] =
+{
+	"frame",
+	"input",
+	"recalculate_lines",
+	"evaluate_document",
+	"evaluate_line",
+	"format_result",
+	"draw_text",
+	"rasterize_glyph",
+	"fill",
+};
+
+#define PROFILE_EVENT_COUNT 65536 // a power of two
+#define PROFILE_FRAME_COUNT 128
+
+struct Profile_Event
+{
+	u64 begin;
+	u64 end;
+	Profile_Stage stage;
+};
+
+struct Profiled_Frame
+{
+	u64 first_event;
+	u64 stage_cycles[Profile_Stage_Count];
+};
+
+struct Profiler
+{
+	// the last PROFILE_EVENT_COUNT events and PROFILE_FRAME_COUNT frames, by how many came before
+	Profile_Event events[PROFILE_EVENT_COUNT];
+	Profiled_Frame frames[PROFILE_FRAME_COUNT];
+	u64 event_count;
+	u64 frame_count;
+
+	bool32 recording; // only inside a frame
+	u64    frame_event;
+
+	u64 first_cycles;
+	u64 first_nanoseconds;
+	f64 cycles_per_microsecond;
+};
+
+#define Profile_None 0xFFFFFFFFFFFFFFFFULL
+
+global Profiler profiler;
+
+internal inline u64
+read_cycle_counter()
+{
+	return(__rdtsc());
+}
+
+internal u64
+read_wall_clock()
+{
+	// in nanoseconds; only ever compared to itself
+	timespec now;
+	timespec_get(&now, TIME_UTC);
+	return((u64)now.tv_sec * 1000000000 + now.tv_nsec);
+}
+
+internal inline u64
+begin_profile_event(Profile_Stage stage)
+{
+	if (!profiler.recording)
+		return(Profile_None);
+	u64 index = profiler.event_count++;
+	Profile_Event *event = profiler.events + (index & (PROFILE_EVENT_COUNT - 1));
+	event->stage = stage;
+	event->begin = read_cycle_counter();
+	event->end   = event->begin;
+	return(index);
+}
+
+internal inline void
+end_profile_event(u64 index)
+{
+	if (index == Profile_None)
+		return;
+	u64 end = read_cycle_counter();
+	// unless so many came after it that it was written over
+	if (profiler.event_count - index <= PROFILE_EVENT_COUNT)
+	{
+		Profile_Event *event = profiler.events + (index & (PROFILE_EVENT_COUNT - 1));
+		event->end = end;
+		Profiled_Frame *frame = profiler.frames + ((profiler.frame_count - 1) % PROFILE_FRAME_COUNT);
+		frame->stage_cycles[event->stage] += end - event->begin;
+	}
+}
+
+struct Profile_Block
+{
+	u64 event;
+	Profile_Block(Profile_Stage stage) { event = begin_profile_event(stage); }
+	~Profile_Block() { end_profile_event(event); }
+};
+
+#if PROFILE
+	#define profile_join(a, b) a##b
+	#define profile_name(line) profile_join(profile_block_, line)
+	#define profile_block(stage) Profile_Block profile_name(__LINE__)(stage)
+#else
+	#define profile_block(stage)
+#endif
+
+internal void
+begin_profile_frame()
+{
+	u64 nanoseconds = read_wall_clock();
+	u64 cycles = read_cycle_counter();
+	if (!profiler.frame_count)
+	{
+		profiler.first_cycles      = cycles;
+		profiler.first_nanoseconds = nanoseconds;
+	}
+	else if (nanoseconds - profiler.first_nanoseconds > 0)
+	{
+		profiler.cycles_per_microsecond =
+			(f64)(cycles - profiler.first_cycles) * 1000 / (nanoseconds - profiler.first_nanoseconds);
+	}
+
+	Profiled_Frame *frame = profiler.frames + (profiler.frame_count++ % PROFILE_FRAME_COUNT);
+	*frame = {};
+	frame->first_event = profiler.event_count;
+	profiler.recording = true;
+	profiler.frame_event = begin_profile_event(Profile_Frame);
+}
+
+internal void
+end_profile_frame()
+{
+	end_profile_event(profiler.frame_event);
+	profiler.recording = false;
+}
+
+internal u32
+get_profile_percentiles(Memory_Arena *temp, Profile_Stage stage, f64 *median, f64 *p99)
+{
+	// over the finished frames still in the ring, in microseconds
+	u64 last = profiler.frame_count - profiler.recording;
+	u64 frame_count = minimum(last, PROFILE_FRAME_COUNT);
+	if (!frame_count || !profiler.cycles_per_microsecond)
+		return(0);
+
+	u64 used = temp->used;
+	u64 *cycles = allocate_array(temp, u64, frame_count);
+	for (u64 i = 0; i < frame_count; ++i)
+	{
+		u64 value = profiler.frames[(last - 1 - i) % PROFILE_FRAME_COUNT].stage_cycles[stage];
+		u64 j = i;
+		for (; j > 0 && cycles[j - 1] > value; --j)
+			cycles[j] = cycles[j - 1];
+		cycles[j] = value;
+	}
+	*median = cycles[(frame_count - 1) / 2] / profiler.cycles_per_microsecond;
+	*p99    = cycles[(frame_count * 99 - 1) / 100] / profiler.cycles_per_microsecond;
+	temp->used = used;
+	return((u32)frame_count);
+}
+
+internal void
+append_text(Memory_Arena *arena, char *text)
+{
+	while (*text)
+		*(u8*)allocate_bytes(arena, 1) = (u8)*text++;
+}
+
+internal void
+append_decimal(Memory_Arena *arena, u64 value, u32 minimum_digits = 1)
+{
+	u8 digits[20];
+	u32 count = 0;
+	do
+	{
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	} while (value || count < minimum_digits);
+	while (count)
+		*(u8*)allocate_bytes(arena, 1) = digits[--count];
+}
+
+internal UTF8_String
+format_profile_trace(Memory_Arena *arena, u64 frame_count)
+{
+	// the last frame_count finished frames, as Chrome trace events, times in microseconds
+	UTF8_String trace = { arena->data + arena->used, 0 };
+	u64 last  = profiler.frame_count - profiler.recording;
+	u64 first = last - minimum(minimum(frame_count, last), PROFILE_FRAME_COUNT);
+	u64 last_event  = profiler.recording? profiler.frame_event : profiler.event_count;
+	u64 first_event = first < last? profiler.frames[first % PROFILE_FRAME_COUNT].first_event : last_event;
+	// events written over are gone, frames whose first one is only start from what there is
+	if (profiler.event_count > PROFILE_EVENT_COUNT)
+		first_event = (u64)maximum(first_event, profiler.event_count - PROFILE_EVENT_COUNT);
+
+	f64 cycles_per_microsecond = profiler.cycles_per_microsecond? profiler.cycles_per_microsecond : 1;
+	u64 origin = first_event < last_event? profiler.events[first_event & (PROFILE_EVENT_COUNT - 1)].begin : 0;
+
+	append_text(arena, "{\"traceEvents\":[");
+	for (u64 i = first_event; i < last_event; ++i)
+	{
+		// room for the longest event and the end
+		if (arena->size - arena->used < 256)
+			break;
+
+		Profile_Event *event = profiler.events + (i & (PROFILE_EVENT_COUNT - 1));
+		u64 begin    = (u64)((event->begin - origin) * 1000 / cycles_per_microsecond);
+		u64 duration = (u64)((event->end - event->begin) * 1000 / cycles_per_microsecond);
+
+		if (i != first_event)
+			append_text(arena, ",");
+		append_text(arena, "\n");
+		append_text(arena, "{\"name\":\"");
+		append_text(arena, profile_stage_names[event->stage]);
+		append_text(arena, "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":");
+		append_decimal(arena, begin / 1000);
+		append_text(arena, ".");
+		append_decimal(arena, begin % 1000, 3);
+		append_text(arena, ",\"dur\":");
+		append_decimal(arena, duration / 1000);
+		append_text(arena, ".");
+		append_decimal(arena, duration % 1000, 3);
+		append_text(arena, "}");
+	}
+	append_text(arena, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	trace.length = arena->data + arena->used - trace.data;
+	return(trace);
+}
@@ -0,0 +1,181 @@
+// system headers first, grs.h defines a swap macro they would trip over
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ninecalc.cpp"
+
+/*
+	Tests of the editor's line cache, on documents made in memory rather than typed,
+	for what the editor can't easily be made to do in a few frames.
+
+	usage: ninecalc_test
+
+	Prints what failed to stderr, and exits with 1 if anything did.
+*/
+
+struct Test_Document
+{
+	Document     document;
+	Line_Cache   cache;
+	Memory_Arena temp;
+};
+
+internal void
+set_test_text(Test_Document *test, char *text)
+{
+	// all of it replaced, with every line from edited_line on marked as edited
+	Document *document = &test->document;
+	u32 previous_line_count = document->line_count;
+	document->buffer.length = 0;
+	for (u64 i = 0; text[i]; ++i)
+		insert_character_if_fits(&document->buffer, (u8)text[i], document->buffer.length);
+	recalculate_lines(document);
+	invalidate_lines(&test->cache, document, 0, previous_line_count);
+	for (u64 i = 0; i < document->line_count; ++i)
+		test->cache.lines[i].dirty = true;
+	test->cache.last_dirty_line = document->line_count - 1;
+}
+
+internal Test_Document
+make_test_document(Memory_Arena *memory, u64 program_bytes)
+{
+	Test_Document test = {};
+	test.document.line_capacity = 1024;
+	test.document.lines  = allocate_array(memory, UTF32_String, test.document.line_capacity);
+	test.document.buffer = make_empty_string(memory, kibibytes(64));
+	recalculate_lines(&test.document);
+	test.cache = make_line_cache(memory, test.document.line_capacity, program_bytes);
+	test.temp  = allocate_arena(memory, mebibytes(1));
+	return(test);
+}
+
+internal bool32
+evaluate_running_sums(Test_Document *test, char *name, char *variable, u32 line_count, u32 round, char *text)
+{
+	// line i sets the variable to 0 + 1 + ... + i, from the one before, with text that changes every round
+	u64 length = 0;
+	length += sprintf(text + length, "%s0: 0", variable);
+	for (u32 i = 1; i < line_count; ++i)
+		length += sprintf(text + length, "\n%s%u: %s%u + %u + 0 * %u", variable, i, variable, i - 1, i, round);
+	set_test_text(test, text);
+
+	test->temp.used = 0;
+	evaluate_document(&test->cache, &test->document, &test->temp);
+
+	for (u32 i = 0; i < line_count; ++i)
+	{
+		Result result = test->cache.lines[i].result;
+		f64 expected = (f64)i * (i + 1) / 2;
+		if (!result.valid || result.value != expected)
+		{
+			fprintf(stderr, "ninecalc_test: %s: round %u: line %u is %s%.0Lf, not %.0Lf\n",
+				name, round, i, result.valid? "" : "invalid, ", result.value, expected);
+			return(false);
+		}
+	}
+	return(true);
+}
+
+internal bool32
+test_program_arena_fills(Memory_Arena *memory)
+{
+	// a program arena far smaller than the programs the document keeps has to grow rather than overflow
+	u64 program_bytes = kibibytes(4);
+	Test_Document test = make_test_document(memory, program_bytes);
+
+	char *text = (char*)malloc(kibibytes(64));
+	bool32 passed = true;
+	for (u32 round = 0; round < 64 && passed; ++round)
+	{
+		passed = evaluate_running_sums(&test, "program arena", "v", 500, round, text);
+		if (test.cache.programs.used > test.cache.programs.size)
+		{
+			fprintf(stderr, "ninecalc_test: program arena: %llu bytes used of %llu\n",
+				test.cache.programs.used, test.cache.programs.size);
+			passed = false;
+		}
+	}
+	if (passed && test.cache.programs.size == program_bytes)
+	{
+		fprintf(stderr, "ninecalc_test: program arena: never grew\n");
+		passed = false;
+	}
+	free(text);
+	return(passed);
+}
+
+internal bool32
+test_atoms_are_recycled(Memory_Arena *memory)
+{
+	// every round names all its variables anew, far more identifiers than the table's arena holds
+	Test_Document test = make_test_document(memory, kibibytes(256));
+
+	char *text = (char*)malloc(kibibytes(64));
+	bool32 passed = true;
+	for (u32 round = 0; round < 64 && passed; ++round)
+	{
+		char variable[32];
+		sprintf(variable, "round%u_v", round);
+		passed = evaluate_running_sums(&test, "atoms", variable, 500, round, text);
+		if (test.cache.identifiers->used > test.cache.identifiers->size)
+		{
+			fprintf(stderr, "ninecalc_test: atoms: %llu bytes used of %llu\n",
+				test.cache.identifiers->used, test.cache.identifiers->size);
+			passed = false;
+		}
+	}
+	if (passed && test.cache.atoms.count >= 64 * 500)
+	{
+		fprintf(stderr, "ninecalc_test: atoms: never recycled, %u of them\n", test.cache.atoms.count);
+		passed = false;
+	}
+	free(text);
+	return(passed);
+}
+
+internal bool32
+test_atoms_in_the_token_arena(Memory_Arena *memory)
+{
+	// evaluate_expression may be given the arena its atoms are interned into
+	Memory_Arena arena = allocate_arena(memory, mebibytes(1));
+	Atom_Table atoms = make_atom_table(&arena, 8);
+	Context context = make_context(&arena, &atoms, 8);
+	char *lines[] = { "first_name: 3", "second_name: first_name * 4", "first_name + second_name / 2" };
+	f64 expected[] = { 3, 12, 9 };
+	bool32 passed = true;
+	for (u32 i = 0; i < array_count(lines); ++i)
+	{
+		UTF8_String line = { (u8*)lines[i], strlen(lines[i]) };
+		Result result = evaluate_expression(&arena, line, &context);
+		if (!result.valid || result.value != expected[i])
+		{
+			fprintf(stderr, "ninecalc_test: atoms in the token arena: \"%s\" is %s%Lg\n",
+				lines[i], result.valid? "" : "invalid, ", result.value);
+			passed = false;
+		}
+	}
+	return(passed);
+}
+
+int
+main()
+{
+	Memory_Arena memory = {};
+	memory.size = mebibytes(64);
+	memory.data = (u8*)malloc(memory.size);
+	if (!memory.data)
+	{
+		fprintf(stderr, "ninecalc_test: out of memory\n");
+		return(1);
+	}
+
+	bool32 passed = true;
+	passed &= test_program_arena_fills(&memory);
+	passed &= test_atoms_are_recycled(&memory);
+	passed &= test_atoms_in_the_token_arena(&memory);
+
+	printf("ninecalc_test: %s\n", passed? "passed" : "failed");
+	return(passed? 0 : 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "ninecalc.h"
+#include "stb_truetype.h"
+#include "font_cache.h"
+
+// Loads a TrueType font at the given line height, to rasterize glyphs from as they are needed.
+// The platform layers read the file, this is the part they share; the font keeps using
+// font_data, so it has to be there as long as the font is.
+
+struct Truetype_Rasterizer
+{
+	stbtt_fontinfo font;
+	f32 scale;
+};
+
+internal bool32
+rasterize_truetype_glyph(Font *font, u32 codepoint, Glyph *glyph, u8 *pixels, u32 stride)
+{
+	Truetype_Rasterizer *rasterizer = (Truetype_Rasterizer*)font->rasterizer;
+	f32 scale = rasterizer->scale;
+
+	s32 glyph_index = stbtt_FindGlyphIndex(&rasterizer->font, codepoint);
+	if (!glyph_index)
+		return(false);
+
+	s32 x0, y0, x1, y1;
+	stbtt_GetGlyphBitmapBox(&rasterizer->font, glyph_index, scale, scale, &x0, &y0, &x1, &y1);
+	glyph->x = (s16)-x0;
+	glyph->y = (s16)-y0;
+	// a cell of the cache fits anything within the font's bounding box
+	glyph->width  = (u16)minimum(x1 - x0, font->atlas.stride);
+	glyph->height = (u16)minimum(y1 - y0, font->atlas.cell_height);
+
+	{ // init glyph.advance
+		s32 advance, lsb;
+		stbtt_GetGlyphHMetrics(&rasterizer->font, glyph_index, &advance, &lsb);
+		glyph->advance = (s16)((f32)advance * scale);
+	}
+
+	stbtt_MakeGlyphBitmap(&rasterizer->font, pixels,
+		glyph->width, glyph->height,
+		stride,
+		scale, scale,
+		glyph_index);
+
+	return(true);
+}
+
+internal Font
+load_font_from_ttf(Memory_Arena *memory, u8 *font_data, u32 line_height)
+{
+	Font loaded_font = {};
+	// init line_height
+	loaded_font.line_height = line_height;
+
+	Truetype_Rasterizer *rasterizer = allocate_struct(memory, Truetype_Rasterizer);
+	stbtt_InitFont(&rasterizer->font, font_data, 0);
+	rasterizer->scale = stbtt_ScaleForPixelHeight(&rasterizer->font, (f32)line_height);
+	loaded_font.rasterizer = rasterizer;
+	loaded_font.rasterize_glyph = rasterize_truetype_glyph;
+
+	f32 scale = rasterizer->scale;
+
+	{ // init baseline
+		s32 temp_basline;
+		stbtt_GetFontVMetrics(&rasterizer->font, &temp_basline, 0, 0);
+		loaded_font.baseline = (u32)((f32)temp_basline * scale);
+	}
+
+	s32 x0, y0, x1, y1;
+	stbtt_GetFontBoundingBox(&rasterizer->font, &x0, &y0, &x1, &y1);
+	init_glyph_cache(memory, &loaded_font,
+		(u32)((f32)(x1 - x0) * scale) + 2,
+		(u32)((f32)(y1 - y0) * scale) + 2);
+
+	return(loaded_font);
+}
@@ -1,6 +1,13 @@
 #pragma once
 #include "grs.h"
 #include "memory_arena.h"
+#include "powers_of_ten.h"
+
+#include <cmath>
+#include <cfloat>
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
 
 struct UTF32_String
 {
@@ -11,6 +18,15 @@ struct UTF32_String
 	u32 &operator[](u64 index);
 };
 
+struct UTF8_String
+{
+	// a view, into a file or a line of one; never written through, so no capacity
+	u8 *data;
+	u64 length;
+
+	u8 &operator[](u64 index);
+};
+
 struct UTF32_String_List
 {
 	UTF32_String *data;
@@ -21,19 +37,27 @@ struct UTF32_String_List
 
 UTF32_String make_empty_string(Memory_Arena *memory, u64 capacity);
 UTF32_String make_string_from_chars(Memory_Arena *memory, char *text);
+UTF32_String make_string_from_utf8(Memory_Arena *memory, u8 *text, u64 size);
+UTF8_String make_utf8_from_string(Memory_Arena *memory, UTF32_String text);
 
 bool32 strings_are_equal(UTF32_String str1, UTF32_String str2);
+bool32 strings_are_equal(UTF8_String str1, UTF8_String str2);
+u64 hash_string(UTF32_String text);
+u64 hash_string(UTF8_String text);
 
 UTF32_String substring(UTF32_String text, u64 offset, u64 size);
 UTF32_String substring(UTF32_String text, u64 offset);
+UTF8_String substring(UTF8_String text, u64 offset, u64 size);
+UTF8_String substring(UTF8_String text, u64 offset);
 
 UTF32_String_List split_lines(Memory_Arena *memory, UTF32_String text);
 
 UTF32_String convert_s64_to_string(Memory_Arena *arena, s64 value);
 UTF32_String convert_s64_to_string(Memory_Arena *arena, s64 value, bool32 negative);
 UTF32_String convert_f64_to_string(Memory_Arena *arena, f64 value);
+u64 format_f64(u32 *buffer, u64 capacity, f64 value, s32 decimals = -1);
 s64 parse_integer(UTF32_String text);
-f64 parse_float(UTF32_String text);
+bool32 parse_float(UTF8_String text, f64 *value);
 
 void reverse_string_in_place(UTF32_String text);
 bool32 insert_character_if_fits(UTF32_String *into, u32 character, u64 at);
@@ -50,6 +74,13 @@ UTF32_String::operator[](u64 index)
 	return(this->data[index]);
 }
 
+u8 &
+UTF8_String::operator[](u64 index)
+{
+	assert(index < this->length);
+	return(this->data[index]);
+}
+
 UTF32_String &
 UTF32_String_List::operator[](u64 index)
 {
@@ -86,6 +117,87 @@ make_string_from_chars(Memory_Arena *memory, char *text)
 	return(string);
 }
 
+UTF32_String
+make_string_from_utf8(Memory_Arena *memory, u8 *text, u64 size)
+{
+	// never more code points than bytes; anything malformed decodes to U+FFFD, one byte at a time
+	UTF32_String string = make_empty_string(memory, size);
+	string.length = 0;
+
+	u64 i = 0;
+	while (i < size)
+	{
+		u32 codepoint = text[i];
+		u32 length = 1;
+		if (codepoint >= 0x80)
+		{
+			u32 extra = 0;
+			u32 smallest = 0;
+			if      ((codepoint & 0xE0) == 0xC0) { codepoint &= 0x1F; extra = 1; smallest = 0x80; }
+			else if ((codepoint & 0xF0) == 0xE0) { codepoint &= 0x0F; extra = 2; smallest = 0x800; }
+			else if ((codepoint & 0xF8) == 0xF0) { codepoint &= 0x07; extra = 3; smallest = 0x10000; }
+
+			while (length <= extra && i + length < size && (text[i + length] & 0xC0) == 0x80)
+				codepoint = (codepoint << 6) | (text[i + length++] & 0x3F);
+
+			// stray continuation bytes, cut off sequences, overlong forms and surrogates
+			if (!extra || length != extra + 1 || codepoint < smallest || codepoint > 0x10FFFF ||
+				(codepoint >= 0xD800 && codepoint <= 0xDFFF))
+			{
+				codepoint = 0xFFFD;
+				length = 1;
+			}
+		}
+		string.data[string.length++] = codepoint;
+		i += length;
+	}
+
+	return(string);
+}
+
+UTF8_String
+make_utf8_from_string(Memory_Arena *memory, UTF32_String text)
+{
+	u64 size = 0;
+	for (u64 i = 0; i < text.length; i++)
+	{
+		u32 codepoint = text.data[i];
+		size += codepoint < 0x80? 1 : codepoint < 0x800? 2 : codepoint < 0x10000? 3 : 4;
+	}
+
+	UTF8_String string;
+	string.data = allocate_array(memory, u8, size);
+	string.length = size;
+
+	u8 *at = string.data;
+	for (u64 i = 0; i < text.length; i++)
+	{
+		u32 codepoint = text.data[i];
+		if (codepoint < 0x80)
+			*at++ = (u8)codepoint;
+		else if (codepoint < 0x800)
+		{
+			*at++ = (u8)(0xC0 | (codepoint >> 6));
+			*at++ = (u8)(0x80 | (codepoint & 0x3F));
+		}
+		else if (codepoint < 0x10000)
+		{
+			*at++ = (u8)(0xE0 | (codepoint >> 12));
+			*at++ = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+			*at++ = (u8)(0x80 | (codepoint & 0x3F));
+		}
+		else
+		{
+			*at++ = (u8)(0xF0 | ((codepoint >> 18) & 0x07));
+			*at++ = (u8)(0x80 | ((codepoint >> 12) & 0x3F));
+			*at++ = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+			*at++ = (u8)(0x80 | (codepoint & 0x3F));
+		}
+	}
+
+	return(string);
+}
+
 UTF32_String
 substring(UTF32_String text, u64 offset, u64 size)
 {
@@ -108,11 +220,31 @@ substring(UTF32_String text, u64 offset)
 	return(substring);
 }
 
+UTF8_String
+substring(UTF8_String text, u64 offset, u64 size)
+{
+	assert(offset + size <= text.length);
+	UTF8_String substring;
+	substring.data = text.data + offset;
+	substring.length = size;
+	return(substring);
+}
+
+UTF8_String
+substring(UTF8_String text, u64 offset)
+{
+	assert(offset <= text.length);
+	UTF8_String substring;
+	substring.data = text.data + offset;
+	substring.length = text.length - offset;
+	return(substring);
+}
+
 UTF32_String_List
 split_lines(Memory_Arena *arena, UTF32_String text)
 {
 	UTF32_String_List substrings = {};
-	substrings.data = (UTF32_String *)((u8*)arena->data + arena->used);
+	substrings.data = cast_tail(arena, UTF32_String);
 
 	u64 last_line = 0;
 	for (u64 i = 0; i < text.length + 1; ++i)
@@ -151,6 +283,51 @@ strings_are_equal(UTF32_String str1, UTF32_String str2)
 	return(are_equal);
 }
 
+u64
+hash_string(UTF32_String text)
+{
+	// FNV-1a over the code points
+	u64 hash = 14695981039346656037ull;
+	for (u64 i = 0; i < text.length; i++)
+	{
+		hash ^= text.data[i];
+		hash *= 1099511628211ull;
+	}
+	return(hash);
+}
+
+bool32
+strings_are_equal(UTF8_String str1, UTF8_String str2)
+{
+	bool32 are_equal = false;
+	if (str1.length == str2.length)
+	{
+		are_equal = true;
+		for (u64 i = 0; i < str1.length; i++)
+		{
+			if (str1.data[i] != str2.data[i])
+			{
+				are_equal = false;
+				break;
+			}
+		}
+	}
+	return(are_equal);
+}
+
+u64
+hash_string(UTF8_String text)
+{
+	// FNV-1a over the bytes
+	u64 hash = 14695981039346656037ull;
+	for (u64 i = 0; i < text.length; i++)
+	{
+		hash ^= text.data[i];
+		hash *= 1099511628211ull;
+	}
+	return(hash);
+}
+
 void
 reverse_string_in_place(UTF32_String text)
 {
@@ -164,7 +341,7 @@ UTF32_String
 convert_s64_to_string(Memory_Arena *arena, s64 value, bool32 negative)
 {
 	UTF32_String result = {};
-	result.data = (u32*)((u8*)arena->data + arena->used);
+	result.data = cast_tail(arena, u32);
 
 	if (negative) value = -value;
 	do
@@ -191,149 +368,811 @@ convert_s64_to_string(Memory_Arena *arena, s64 value)
 	return(convert_s64_to_string(arena, is_negative? -value : value, is_negative));
 }
 
-internal s16
-normalize_f64(f64 *value)
-{
-	const f64 large_threshold = 1e16;
-	const f64 small_threshold = 1e-14;
-	s16 exponent = 0;
-
-	if (*value >= large_threshold)
-	{
-		if (*value >= 1e256) {
-	      *value /= 1e256;
-	      exponent += 256;
-	    }
-	    if (*value >= 1e128) {
-	      *value /= 1e128;
-	      exponent += 128;
-	    }
-	    if (*value >= 1e64) {
-	      *value /= 1e64;
-	      exponent += 64;
-	    }
-	    if (*value >= 1e32) {
-	      *value /= 1e32;
-	      exponent += 32;
-	    }
-	    if (*value >= 1e16) {
-	      *value /= 1e16;
-	      exponent += 16;
-	    }
-	    if (*value >= 1e8) {
-	      *value /= 1e8;
-	      exponent += 8;
-	    }
-	    if (*value >= 1e4) {
-	      *value /= 1e4;
-	      exponent += 4;
-	    }
-	    if (*value >= 1e2) {
-	      *value /= 1e2;
-	      exponent += 2;
-	    }
-	    if (*value >= 1e1) {
-	      *value /= 1e1;
-	      exponent += 1;
-	    }
-	}
-
-	if (*value > 0 && *value <= small_threshold)
-	{
-	    if (*value < 1e-255) {
-	      *value *= 1e256;
-	      exponent -= 256;
-	    }
-	    if (*value < 1e-127) {
-	      *value *= 1e128;
-	      exponent -= 128;
-	    }
-	    if (*value < 1e-63) {
-	      *value *= 1e64;
-	      exponent -= 64;
-	    }
-	    if (*value < 1e-31) {
-	      *value *= 1e32;
-	      exponent -= 32;
-	    }
-	    if (*value < 1e-15) {
-	      *value *= 1e16;
-	      exponent -= 16;
-	    }
-	    if (*value < 1e-7) {
-	      *value *= 1e8;
-	      exponent -= 8;
-	    }
-	    if (*value < 1e-3) {
-	      *value *= 1e4;
-	      exponent -= 4;
-	    }
-	    if (*value < 1e-1) {
-	      *value *= 1e2;
-	      exponent -= 2;
-	    }
-	    if (*value < 1e0) {
-	      *value *= 1e1;
-	      exponent -= 1;
-	    }
-	}
-
-	return(exponent);
+// f64 is a long double, which is only as wide as a double with msvc
+#define F64_MANTISSA_BITS (LDBL_MANT_DIG - 1) // below the leading bit
+#define F64_MIN_EXPONENT  (LDBL_MIN_EXP - 1)
+#define F64_MAX_EXPONENT  (LDBL_MAX_EXP - 1)
+#define F64_MAX_EXACT_POWER_OF_TEN (LDBL_MANT_DIG >= 64? 27 : 22)
+#define F64_MAX_EXACT_INTEGER      (~(u64)0 >> (63 - F64_MANTISSA_BITS))
+#define F64_MAX_DECIMALS 20 // the most places format_f64 rounds to, so the digits fit 128 bits
+
+global f64 exact_powers_of_ten[] = {
+	1e0L,  1e1L,  1e2L,  1e3L,  1e4L,  1e5L,  1e6L,  1e7L,  1e8L,  1e9L,
+	1e10L, 1e11L, 1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L,
+	1e20L, 1e21L, 1e22L, 1e23L, 1e24L, 1e25L, 1e26L, 1e27L,
+};
+
+internal inline s32
+floor_log2_power_of_ten(s32 power)
+{
+	// exact for |power| up to 5100
+	return((s32)(((s64)power * 14267572527) >> 32));
+}
+
+internal inline s32
+floor_log10_power_of_two(s32 power)
+{
+	// exact for |power| up to 16600
+	return((s32)(((s64)power * 1292913986) >> 32));
 }
 
-UTF32_String
-convert_f64_to_string(Memory_Arena *arena, f64 value)
+internal inline s32
+floor_log10_power_of_five(s32 power)
 {
-	UTF32_String result = {};
-	result.data = (u32*)((u8*)arena->data + arena->used);
+	// exact for power from 0 to 17000
+	return((s32)(((s64)power * 3002053309) >> 32));
+}
+
+// 128-bit integers, for the digits of an f64 and their products with powers_of_ten
+struct U128
+{
+	u64 high;
+	u64 low;
+};
+
+internal inline U128
+multiply_u64(u64 a, u64 b)
+{
+	U128 product;
+#if defined(_MSC_VER)
+	product.low = _umul128(a, b, &product.high);
+#else
+	unsigned __int128 wide = (unsigned __int128)a * b;
+	product.high = (u64)(wide >> 64);
+	product.low  = (u64)wide;
+#endif
+	return(product);
+}
+
+internal inline s32
+count_bits(u64 value)
+{
+	// up to and including the highest one set
+#if defined(_MSC_VER)
+	unsigned long index;
+	return(_BitScanReverse64(&index, value)? (s32)index + 1 : 0);
+#else
+	return(value? 64 - __builtin_clzll(value) : 0);
+#endif
+}
+
+internal inline s32
+count_trailing_zeros(u64 value)
+{
+	// of a nonzero value
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return((s32)index);
+#else
+	return(__builtin_ctzll(value));
+#endif
+}
+
+internal inline s32
+count_bits(U128 value)
+{
+	return(value.high? 64 + count_bits(value.high) : count_bits(value.low));
+}
+
+internal inline bool32
+equal_u128(U128 a, U128 b)
+{
+	return(a.high == b.high && a.low == b.low);
+}
+
+internal inline U128
+add_u128(U128 a, u64 b)
+{
+	U128 sum = { a.high, a.low + b };
+	sum.high += sum.low < b;
+	return(sum);
+}
+
+internal inline U128
+subtract_u128(U128 a, u64 b)
+{
+	U128 difference = { a.high, a.low - b };
+	difference.high -= a.low < b;
+	return(difference);
+}
+
+internal inline bool32
+less_u128(U128 a, U128 b)
+{
+	return(a.high < b.high || (a.high == b.high && a.low < b.low));
+}
+
+internal inline U128
+shift_left_u128(U128 value, s32 shift)
+{
+	if (shift >= 128)
+		return(U128{ 0, 0 });
+	if (shift >= 64)
+		return(U128{ value.low << (shift - 64), 0 });
+	if (!shift)
+		return(value);
+	return(U128{ value.high << shift | value.low >> (64 - shift), value.low << shift });
+}
+
+internal inline U128
+shift_right_u128(U128 value, s32 shift)
+{
+	if (shift >= 128)
+		return(U128{ 0, 0 });
+	if (shift >= 64)
+		return(U128{ 0, value.high >> (shift - 64) });
+	if (!shift)
+		return(value);
+	return(U128{ value.high >> shift, value.low >> shift | value.high << (64 - shift) });
+}
+
+internal inline u32
+divide_u128(U128 *value, u32 divisor)
+{
+	// by a small divisor, with only 64-bit divisions: 2^64 = q * divisor + r, so the high
+	// word's remainder h carries down as h * q and (h * r + low) / divisor; returns the remainder
+	u64 q = ~(u64)0 / divisor;
+	u64 r = ~(u64)0 % divisor + 1;
+	u64 carried = value->high % divisor;
+	u64 rest = carried * r + value->low % divisor;
+	value->high /= divisor;
+	value->low = carried * q + value->low / divisor + rest / divisor;
+	return((u32)(rest % divisor));
+}
+
+internal void
+multiply_u128(U128 a, U128 b, u64 product[4])
+{
+	// the full 256 bits, lowest word first
+	U128 low_low   = multiply_u64(a.low,  b.low);
+	U128 low_high  = multiply_u64(a.low,  b.high);
+	U128 high_low  = multiply_u64(a.high, b.low);
+	U128 high_high = multiply_u64(a.high, b.high);
+
+	u64 middle = low_low.high + low_high.low;
+	u64 carry = middle < low_low.high;
+	middle += high_low.low;
+	carry += middle < high_low.low;
+
+	u64 upper = high_high.low + carry;
+	u64 upper_carry = upper < carry;
+	upper += low_high.high;
+	upper_carry += upper < low_high.high;
+	upper += high_low.high;
+	upper_carry += upper < high_low.high;
+
+	product[0] = low_low.low;
+	product[1] = middle;
+	product[2] = upper;
+	product[3] = high_high.high + upper_carry;
+}
+
+internal U128
+shift_right_u256(u64 words[4], s32 shift)
+{
+	// the low 128 bits of words >> shift
+	if (shift >= 256)
+		return(U128{ 0, 0 });
+	s32 word = shift / 64;
+	s32 bit  = shift % 64;
+	u64 low    = words[word];
+	u64 middle = word < 3? words[word + 1] : 0;
+	u64 high   = word < 2? words[word + 2] : 0;
+	if (!bit)
+		return(U128{ middle, low });
+	return(U128{ middle >> bit | high << (64 - bit), low >> bit | middle << (64 - bit) });
+}
+
+struct Power_Of_Ten
+{
+	// 10^power is significand * 2^exponent, or less than 3 more units of it unless exact
+	U128   significand;
+	s32    exponent;
+	s32    power;
+	bool32 exact;
+};
+
+internal Power_Of_Ten
+get_power_of_ten(s32 power)
+{
+	assert(power >= POWER_OF_TEN_MIN && power <= POWER_OF_TEN_MAX);
+	s32 coarse = (power - POWER_OF_TEN_MIN) / 32;
+	s32 fine   = (power - POWER_OF_TEN_MIN) % 32;
+	U128 a = { powers_of_ten_by_32[coarse][0], powers_of_ten_by_32[coarse][1] };
+	U128 b = { powers_of_ten_by_1[fine][0],    powers_of_ten_by_1[fine][1] };
+	u64 product[4];
+	multiply_u128(a, b, product);
+
+	// each has its top bit set, so the product has one of its top two
+	s32 top = (s32)(product[3] >> 63);
+	s32 coarse_power = power - fine;
+	Power_Of_Ten result;
+	if (top)
+		result.significand = U128{ product[3], product[2] };
+	else
+		result.significand = U128{ product[3] << 1 | product[2] >> 63, product[2] << 1 | product[1] >> 63 };
+	result.exponent = floor_log2_power_of_ten(coarse_power) + floor_log2_power_of_ten(fine) - 127 + top;
+	result.power = power;
+	result.exact = power >= 0 && power <= 55;
+	return(result);
+}
+
+// big enough for a 128-bit integer times 5^-POWER_OF_TEN_MIN, with some to spare
+#define BIG_INTEGER_LIMBS 380
+
+struct Big_Integer
+{
+	// lowest limb first, no leading zero limbs
+	u32 limbs[BIG_INTEGER_LIMBS];
+	u32 count;
+};
+
+internal void
+set_big_integer(Big_Integer *big, U128 value)
+{
+	big->limbs[0] = (u32)value.low;
+	big->limbs[1] = (u32)(value.low >> 32);
+	big->limbs[2] = (u32)value.high;
+	big->limbs[3] = (u32)(value.high >> 32);
+	big->count = 4;
+	while (big->count && !big->limbs[big->count - 1])
+		--big->count;
+}
+
+internal void
+multiply_big_integer(Big_Integer *big, u32 factor)
+{
+	u64 carry = 0;
+	for (u32 i = 0; i < big->count; ++i)
+	{
+		u64 product = (u64)big->limbs[i] * factor + carry;
+		big->limbs[i] = (u32)product;
+		carry = product >> 32;
+	}
+	if (carry)
+		big->limbs[big->count++] = (u32)carry;
+}
+
+internal void
+multiply_big_integer_by_power_of_five(Big_Integer *big, s32 power)
+{
+	// 5^13 is the most that fits a limb
+	for (; power >= 13; power -= 13)
+		multiply_big_integer(big, 1220703125);
+	u32 factor = 1;
+	for (; power > 0; --power)
+		factor *= 5;
+	multiply_big_integer(big, factor);
+}
+
+internal void
+shift_big_integer_left(Big_Integer *big, s32 shift)
+{
+	if (!big->count)
+		return;
+	u32 limbs = shift / 32;
+	u32 bits  = shift % 32;
+	big->limbs[big->count] = 0;
+	for (u32 i = big->count + 1; i-- > 0;)
+	{
+		u32 below = (bits && i)? big->limbs[i - 1] >> (32 - bits) : 0;
+		big->limbs[i + limbs] = (bits? big->limbs[i] << bits : big->limbs[i]) | below;
+	}
+	for (u32 i = 0; i < limbs; ++i)
+		big->limbs[i] = 0;
+	big->count += limbs + 1;
+	while (big->count && !big->limbs[big->count - 1])
+		--big->count;
+}
+
+internal s32
+compare_big_integers(Big_Integer *a, Big_Integer *b)
+{
+	if (a->count != b->count)
+		return(a->count < b->count? -1 : 1);
+	for (u32 i = a->count; i-- > 0;)
+	{
+		if (a->limbs[i] != b->limbs[i])
+			return(a->limbs[i] < b->limbs[i]? -1 : 1);
+	}
+	return(0);
+}
+
+internal bool32
+is_integer_product(U128 x, s32 power_of_two, s32 power_of_ten)
+{
+	// x * 2^(power_of_two + power_of_ten) * 5^power_of_ten, if x has the 2s and 5s it divides by
+	if (!x.high && !x.low)
+		return(true);
+	s32 twos = power_of_two + power_of_ten;
+	s32 zeros = x.low? count_trailing_zeros(x.low) : 64 + count_trailing_zeros(x.high);
+	if (zeros < -twos)
+		return(false);
+	// 5^56 is past 128 bits, so this stops well before a big power
+	for (s32 fives = power_of_ten; fives < 0; ++fives)
+	{
+		if (divide_u128(&x, 5))
+			return(false);
+	}
+	return(true);
+}
+
+struct Scaled
+{
+	U128   integer; // the part before the point
+	bool32 exact;   // nothing after it
+};
+
+internal Scaled
+multiply_by_powers(U128 x, s32 power_of_two, Power_Of_Ten power)
+{
+	// x * 2^power_of_two * 10^power.power, for a result of well under 128 bits.
+	// The table's 10^power.power is up to 3 units short, so the product is known to within 3x.
+	// Only if that spans an integer does it come down to comparing exactly, with big integers.
+	s32 power_of_ten = power.power;
+	u64 product[4];
+	multiply_u128(x, power.significand, product);
+	s32 shift = -(power.exponent + power_of_two);
+	assert(shift > 0);
+
+	Scaled scaled;
+	scaled.integer = shift_right_u256(product, shift);
+	scaled.exact = is_integer_product(x, power_of_two, power_of_ten);
+	if (power.exact)
+		return(scaled);
+
+	// 3x on top
+	U128 error = add_u128(shift_left_u128(x, 1), x.low);
+	error.high += x.high;
+	u64 error_words[4] = { error.low, error.high, 0, 0 };
+	u64 most[4];
+	u64 carry = 0;
+	for (s32 i = 0; i < 4; ++i)
+	{
+		u64 sum = product[i] + error_words[i];
+		u64 overflow = sum < product[i];
+		most[i] = sum + carry;
+		carry = overflow | (most[i] < carry);
+	}
+	U128 above = shift_right_u256(most, shift);
+	if (equal_u128(above, scaled.integer))
+		return(scaled);
+
+	// past an integer: an integer result is that one; anything else is compared against it
+	if (!scaled.exact)
+	{
+		Big_Integer value, bound;
+		set_big_integer(&value, x);
+		set_big_integer(&bound, above);
+		s32 twos = power_of_two + power_of_ten;
+		multiply_big_integer_by_power_of_five(power_of_ten >= 0? &value : &bound, power_of_ten >= 0? power_of_ten : -power_of_ten);
+		shift_big_integer_left(twos >= 0? &value : &bound, twos >= 0? twos : -twos);
+		if (compare_big_integers(&value, &bound) < 0)
+			return(scaled);
+	}
+	scaled.integer = above;
+	return(scaled);
+}
+
+// enough to hold any f64 exactly, so only longer literals round through 'truncated'
+#define DECIMAL_DIGITS (LDBL_MANT_DIG >= 64? 11600 : 800)
+
+struct Decimal
+{
+	// 0.d1d2d3... * 10^point, one digit per byte
+	u8     digits[DECIMAL_DIGITS];
+	u32    count;
+	s32    point;
+	bool32 truncated; // nonzero digits were dropped past the end
+};
+
+internal void
+trim_decimal(Decimal *decimal)
+{
+	while (decimal->count && !decimal->digits[decimal->count - 1])
+		--decimal->count;
+	if (!decimal->count)
+		decimal->point = 0;
+}
+
+internal void
+shift_decimal_left(Decimal *decimal, u32 shift)
+{
+	// times 2^shift, from the last digit up into a scratch copy, as the number only gets longer
+	const u32 scratch_size = DECIMAL_DIGITS + 20;
+	u8 shifted[scratch_size];
+	u32 write = scratch_size;
+	u64 n = 0;
+	for (u32 read = decimal->count; read-- > 0;)
+	{
+		n += (u64)decimal->digits[read] << shift;
+		u64 quotient = n / 10;
+		shifted[--write] = (u8)(n - 10 * quotient);
+		n = quotient;
+	}
+	while (n)
+	{
+		u64 quotient = n / 10;
+		shifted[--write] = (u8)(n - 10 * quotient);
+		n = quotient;
+	}
 
-	bool32 was_negative = value < 0;
-	if (was_negative) value = -value;
+	u32 count = scratch_size - write;
+	decimal->point += (s32)count - (s32)decimal->count;
+	decimal->count = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (i < DECIMAL_DIGITS)
+			decimal->digits[decimal->count++] = shifted[write + i];
+		else if (shifted[write + i])
+			decimal->truncated = true;
+	}
+	trim_decimal(decimal);
+}
 
-	s16 exponent = normalize_f64(&value);
+internal void
+shift_decimal_right(Decimal *decimal, u32 shift)
+{
+	// divided by 2^shift, carrying the remainder down the digits
+	u32 read = 0, write = 0;
+	u64 n = 0;
+	while (!(n >> shift))
+	{
+		if (read < decimal->count)
+			n = 10 * n + decimal->digits[read];
+		else if (n)
+			n = 10 * n;
+		else
+		{
+			decimal->count = 0;
+			trim_decimal(decimal);
+			return;
+		}
+		++read;
+	}
+	decimal->point -= (s32)read - 1;
 
-	s64 integral_part = (s64)value;
-	UTF32_String integral_string = convert_s64_to_string(arena, was_negative? -integral_part : integral_part, was_negative);
+	u64 mask = ((u64)1 << shift) - 1;
+	for (; read < decimal->count; ++read)
+	{
+		decimal->digits[write++] = (u8)(n >> shift);
+		n = 10 * (n & mask) + decimal->digits[read];
+	}
+	while (n)
+	{
+		u8 digit = (u8)(n >> shift);
+		if (write < DECIMAL_DIGITS)
+			decimal->digits[write++] = digit;
+		else if (digit)
+			decimal->truncated = true;
+		n = 10 * (n & mask);
+	}
+	decimal->count = write;
+	trim_decimal(decimal);
+}
 
-	s64 decimal_part = (s64)((value - integral_part) * 1e15 + 0.5);
-	u8 width = 15;
-	if (decimal_part)
+internal void
+shift_decimal(Decimal *decimal, s32 shift)
+{
+	// 60 bits at a time, so ten times a shifted digit still fits in 64
+	if (shift > 0)
 	{
-		for (; decimal_part && decimal_part % 10 == 0 ; decimal_part /= 10)
-			--width;
+		for (; shift > 0; shift -= 60)
+			shift_decimal_left(decimal, (u32)minimum(shift, 60));
 	}
 	else
 	{
-		return(integral_string);
+		for (; shift < 0; shift += 60)
+			shift_decimal_right(decimal, (u32)minimum(-shift, 60));
 	}
+}
 
-	UTF32_String decimal_string = {};
-	decimal_string.data = (u32*)((u8*)arena->data + arena->used);
-	do
+internal bool32
+should_round_decimal_up(Decimal *decimal, s32 count)
+{
+	// to nearest, ties to even unless something was dropped past the tie
+	if (count < 0 || count >= (s32)decimal->count)
+		return(false);
+	if (decimal->digits[count] == 5 && count + 1 == (s32)decimal->count && !decimal->truncated)
+		return(count > 0 && (decimal->digits[count - 1] & 1));
+	return(decimal->digits[count] >= 5);
+}
+
+struct Float_Literal
+{
+	// digits * 10^power, a little more if 'truncated'
+	U128   digits;
+	s32    power;
+	bool32 truncated; // nonzero digits were dropped past the first 38
+};
+
+internal bool32
+find_shortest_fraction(Float_Literal *literal, f64 value, u64 mantissa)
+{
+	// Most results are plain numbers with a few places. For those, the fewest places k at which
+	// round(value * 10^k) / 10^k reads back as value (an exact division, like parse_float's)
+	// give the same digits as find_shortest_digits, without the 128-bit products.
+	// That needs evenly spaced neighbours (not a power of two), exact digits and powers of ten,
+	// and a value away from where the notation switches; anything else returns false.
+	if (mantissa == ((u64)1 << F64_MANTISSA_BITS) || value < 1e-13L || value >= 1e15L)
+		return(false);
+
+	// reading back is monotonic in k, so binary search for the first k that does
+	s32 low  = 0;
+	s32 high = F64_MAX_EXACT_POWER_OF_TEN;
+	s32 found_places  = -1;
+	u32 found_matches = 0;
+	u64 found_digits  = 0;
+	while (low <= high)
+	{
+		s32 places = (low + high) / 2;
+		f64 power = exact_powers_of_ten[places];
+		f64 scaled = value * power;
+		if (scaled >= (f64)(F64_MAX_EXACT_INTEGER >> 1))
+		{
+			// can't tell, but more places won't help either
+			found_places  = places;
+			found_matches = 0;
+			high = places - 1;
+			continue;
+		}
+
+		// the nearest candidate is one of these two, whichever way the product rounded
+		u64 below = (u64)scaled;
+		u32 matches = 0;
+		u64 digits = 0;
+		if ((f64)below / power == value)
+		{
+			digits = below;
+			++matches;
+		}
+		if ((f64)(below + 1) / power == value)
+		{
+			digits = below + 1;
+			++matches;
+		}
+
+		if (matches)
+		{
+			found_places  = places;
+			found_matches = matches;
+			found_digits  = digits;
+			high = places - 1;
+		}
+		else
+			low = places + 1;
+	}
+
+	// two that read back means the nearest has to be decided exactly
+	if (found_matches != 1)
+		return(false);
+
+	literal->digits = U128{ 0, found_digits };
+	literal->power  = -found_places;
+	return(true);
+}
+
+internal Float_Literal
+find_shortest_digits(u64 mantissa, s32 exponent)
+{
+	// The fewest digits that still read back as mantissa * 2^(exponent - F64_MANTISSA_BITS),
+	// i.e. that stay within the halfway points to its neighbours. This is Ryu (Adams 2018) for
+	// any mantissa width: the value and both halfway points, times 4 so they are integers,
+	// are scaled by a power of ten that leaves some ten units between them. Then digits come
+	// off all three while the halfway points still differ.
+	Float_Literal literal = {};
+	s32 power_of_two = exponent - F64_MANTISSA_BITS - 2;
+	U128 middle = shift_left_u128(U128{ 0, mantissa }, 2);
+	U128 upper  = add_u128(middle, 2);
+	// below a power of two the neighbour is half as far
+	U128 lower  = subtract_u128(middle, (mantissa != (u64)1 << F64_MANTISSA_BITS || exponent == F64_MIN_EXPONENT)? 2 : 1);
+	// round to even keeps the halfway points themselves
+	bool32 inclusive = !(mantissa & 1);
+
+	if (power_of_two >= 0)
+		literal.power = floor_log10_power_of_two(power_of_two) - (power_of_two > 3);
+	else
+		literal.power = floor_log10_power_of_five(-power_of_two) - (-power_of_two > 1) + power_of_two;
+	Power_Of_Ten power = get_power_of_ten(-literal.power);
+	Scaled scaled_middle = multiply_by_powers(middle, power_of_two, power);
+	Scaled scaled_upper  = multiply_by_powers(upper,  power_of_two, power);
+	Scaled scaled_lower  = multiply_by_powers(lower,  power_of_two, power);
+	U128 digits = scaled_middle.integer;
+	upper = scaled_upper.integer;
+	lower = scaled_lower.integer;
+	if (!inclusive && scaled_upper.exact)
+		upper = subtract_u128(upper, 1);
+
+	// whether everything cut off so far was zeros, to round exact ties to even and keep an exact lower bound
+	bool32 middle_is_exact = scaled_middle.exact;
+	bool32 lower_is_exact  = inclusive && scaled_lower.exact;
+	u32 last_removed = 0;
+	for (;;)
+	{
+		U128 upper_tens = upper;
+		U128 lower_tens = lower;
+		divide_u128(&upper_tens, 10);
+		u32 lower_digit = divide_u128(&lower_tens, 10);
+		if (!less_u128(lower_tens, upper_tens))
+			break;
+		middle_is_exact &= !last_removed;
+		last_removed = divide_u128(&digits, 10);
+		lower_is_exact &= !lower_digit;
+		upper = upper_tens;
+		lower = lower_tens;
+		++literal.power;
+	}
+	if (lower_is_exact)
+	{
+		// the lower bound itself is in, so its trailing zeros can go as well
+		for (;;)
+		{
+			U128 lower_tens = lower;
+			if (divide_u128(&lower_tens, 10))
+				break;
+			middle_is_exact &= !last_removed;
+			last_removed = divide_u128(&digits, 10);
+			divide_u128(&upper, 10);
+			lower = lower_tens;
+			++literal.power;
+		}
+	}
+	if (middle_is_exact && last_removed == 5 && !(digits.low & 1))
+		last_removed = 4;
+	bool32 round_up = (equal_u128(digits, lower) && (!inclusive || !lower_is_exact)) || last_removed >= 5;
+	literal.digits = add_u128(digits, round_up);
+	return(literal);
+}
+
+internal s32
+find_decimal_exponent(u64 mantissa, s32 exponent)
+{
+	// floor(log10 value), which the binary exponent puts at one of two
+	s32 estimate = floor_log10_power_of_two(count_bits(mantissa) - 1 + exponent - F64_MANTISSA_BITS);
+	Scaled scaled = multiply_by_powers(U128{ 0, mantissa }, exponent - F64_MANTISSA_BITS, get_power_of_ten(-(estimate + 1)));
+	return(estimate + (scaled.integer.low != 0));
+}
+
+internal Float_Literal
+round_to_places(u64 mantissa, s32 exponent, s32 places)
+{
+	// mantissa * 2^(exponent - F64_MANTISSA_BITS) rounded to 'places' after the point, ties to even;
+	// doubled, so the last bit says which side of halfway it is
+	Scaled doubled = multiply_by_powers(U128{ 0, mantissa }, exponent - F64_MANTISSA_BITS + 1, get_power_of_ten(places));
+	U128 digits = shift_right_u128(doubled.integer, 1);
+	if ((doubled.integer.low & 1) && (!doubled.exact || (digits.low & 1)))
+		digits = add_u128(digits, 1);
+	return(Float_Literal{ digits, -places, false });
+}
+
+internal void
+put_codepoint(u32 *buffer, u64 capacity, u64 *length, u32 codepoint)
+{
+	if (*length < capacity)
+		buffer[*length] = codepoint;
+	++*length;
+}
+
+u64
+format_f64(u32 *buffer, u64 capacity, f64 value, s32 decimals)
+{
+	// the shortest digits that read back as 'value' when 'decimals' is negative,
+	// otherwise rounded to that many places after the point (of the mantissa, in scientific notation),
+	// up to F64_MAX_DECIMALS; writes at most 'capacity' code points and returns how many it wrote
+	u64 length = 0;
+	if (value != value)
 	{
-		*allocate_struct(arena, u32) = (decimal_part % 10) + '0';
-		++decimal_string.length; ++decimal_string.capacity;
-		--width;
-		decimal_part /= 10;
-	} while (decimal_part);
-	while (width--)
+		put_codepoint(buffer, capacity, &length, 'n');
+		put_codepoint(buffer, capacity, &length, 'a');
+		put_codepoint(buffer, capacity, &length, 'n');
+		return(minimum(length, capacity));
+	}
+	if (value < 0)
+	{
+		put_codepoint(buffer, capacity, &length, '-');
+		value = -value;
+	}
+	if (value == HUGE_VALL)
+	{
+		put_codepoint(buffer, capacity, &length, 'i');
+		put_codepoint(buffer, capacity, &length, 'n');
+		put_codepoint(buffer, capacity, &length, 'f');
+		return(minimum(length, capacity));
+	}
+
+	// value = mantissa * 2^(exponent - F64_MANTISSA_BITS), with subnormals held at the smallest exponent
+	u64 mantissa = 0;
+	s32 exponent = 0;
+	if (value != 0)
+	{
+		int binary_exponent;
+		f64 fraction = std::frexp(value, &binary_exponent);
+		mantissa = (u64)std::ldexp(fraction, F64_MANTISSA_BITS + 1);
+		exponent = binary_exponent - 1;
+		if (exponent < F64_MIN_EXPONENT)
+		{
+			mantissa >>= F64_MIN_EXPONENT - exponent;
+			exponent = F64_MIN_EXPONENT;
+		}
+	}
+
+	// plain between 1e-14 and 1e16, scientific past that (the short path stays inside that)
+	Float_Literal literal = {};
+	bool32 is_scientific = false;
+	if (mantissa && decimals >= 0)
 	{
-		*allocate_struct(arena, u32) = '0';
-		++decimal_string.length; ++decimal_string.capacity;
+		s32 decimal_exponent = find_decimal_exponent(mantissa, exponent);
+		is_scientific = decimal_exponent <= -14 || decimal_exponent >= 16;
+		decimals = (s32)minimum(decimals, F64_MAX_DECIMALS);
+		literal = round_to_places(mantissa, exponent, is_scientific? decimals - decimal_exponent : decimals);
+	}
+	else if (mantissa && !find_shortest_fraction(&literal, value, mantissa))
+	{
+		// 1e16 is exact, 1e-13 isn't, so the one nearest to it needs the exact test
+		is_scientific = value >= 1e16L || value < 1e-13L ||
+			(value == 1e-13L && find_decimal_exponent(mantissa, exponent) <= -14);
+		literal = find_shortest_digits(mantissa, exponent);
+	}
+
+	// 0.d1d2d3... * 10^point, one digit per byte, without trailing zeros
+	u8 reversed[40];
+	s32 count = 0;
+	for (U128 rest = literal.digits; rest.high || rest.low;)
+		reversed[count++] = (u8)divide_u128(&rest, 10);
+	s32 point = count + literal.power;
+	s32 zeros = 0;
+	while (zeros < count && !reversed[zeros])
+		++zeros;
+	u8 digits[40];
+	for (s32 i = zeros; i < count; ++i)
+		digits[count - 1 - i] = reversed[i];
+	count -= zeros;
+	if (!count)
+	{
+		point = 1;
+		is_scientific = false;
 	}
-	*allocate_struct(arena, u32) = '.';
-	++decimal_string.length; ++decimal_string.capacity;
 
-	reverse_string_in_place(decimal_string);
+	s32 first_digit = is_scientific? point - 1 : 0;
+	s32 integer_digits = maximum(point - first_digit, 1);
+	s32 fraction_digits = (decimals >= 0)? decimals : maximum(count - (point - first_digit), 0);
 
-	if (exponent)
+	// digit i counts from the first one before the point, which may be a leading zero
+	for (s32 i = 0; i < integer_digits + fraction_digits; ++i)
 	{
-		*allocate_struct(arena, u32) = 'e';
-		convert_s64_to_string(arena, exponent);
+		if (i == integer_digits)
+			put_codepoint(buffer, capacity, &length, '.');
+		s32 index = i + (point - first_digit < 1? point - first_digit - 1 : 0);
+		u8 digit = (index >= 0 && index < count)? digits[index] : 0;
+		put_codepoint(buffer, capacity, &length, '0' + digit);
 	}
 
-	result.length = result.capacity = (u32*)((u8*)arena->data + arena->used) - result.data;
+	if (is_scientific)
+	{
+		put_codepoint(buffer, capacity, &length, 'e');
+		if (first_digit < 0)
+		{
+			put_codepoint(buffer, capacity, &length, '-');
+			first_digit = -first_digit;
+		}
+		s32 place = 1;
+		while (place <= first_digit / 10)
+			place *= 10;
+		for (; place; place /= 10)
+			put_codepoint(buffer, capacity, &length, '0' + (first_digit / place) % 10);
+	}
+
+	return(minimum(length, capacity));
+}
 
+UTF32_String
+convert_f64_to_string(Memory_Arena *arena, f64 value)
+{
+	UTF32_String result = {};
+	result.data = cast_tail(arena, u32);
+	result.length = result.capacity = format_f64(result.data, (arena->size - arena->used) / sizeof(u32), value, -1);
+	allocate_array(arena, u32, result.length);
 	return(result);
 }
 
@@ -426,35 +1265,280 @@ parse_integer(UTF32_String text)
 	return(result);
 }
 
-f64
-parse_float(UTF32_String text)
+internal f64
+convert_decimal_to_f64(Decimal *decimal)
+{
+	// exact: halve or double the decimal into [1, 2), then round the digits left past the mantissa
+	if (!decimal->count || decimal->point < LDBL_MIN_10_EXP - 30)
+		return(0);
+	if (decimal->point > LDBL_MAX_10_EXP + 1)
+		return(HUGE_VALL);
+
+	persistent s32 shifts_for_digits[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+	const s32 shift_count = sizeof(shifts_for_digits) / sizeof(*shifts_for_digits);
+	s32 exponent = 0;
+	while (decimal->point > 0)
+	{
+		s32 shift = decimal->point < shift_count? shifts_for_digits[decimal->point] : 27;
+		shift_decimal(decimal, -shift);
+		exponent += shift;
+	}
+	while (decimal->point < 0 || (decimal->point == 0 && decimal->digits[0] < 5))
+	{
+		s32 shift = -decimal->point < shift_count? shifts_for_digits[-decimal->point] : 27;
+		shift_decimal(decimal, shift);
+		exponent -= shift;
+	}
+
+	// [0.5, 1) to [1, 2), with subnormals held at the smallest exponent
+	--exponent;
+	if (exponent < F64_MIN_EXPONENT)
+	{
+		shift_decimal(decimal, exponent - F64_MIN_EXPONENT);
+		exponent = F64_MIN_EXPONENT;
+	}
+	if (exponent > F64_MAX_EXPONENT)
+		return(HUGE_VALL);
+
+	shift_decimal(decimal, F64_MANTISSA_BITS + 1);
+	u64 mantissa = 0;
+	s32 i = 0;
+	for (; i < decimal->point && i < (s32)decimal->count; ++i)
+		mantissa = 10 * mantissa + decimal->digits[i];
+	for (; i < decimal->point; ++i)
+		mantissa *= 10;
+
+	if (should_round_decimal_up(decimal, decimal->point) && ++mantissa == ((u64)2 << F64_MANTISSA_BITS))
+	{
+		// carried into a new bit (which wraps to 0 with a 64-bit mantissa)
+		mantissa = (u64)1 << F64_MANTISSA_BITS;
+		if (++exponent > F64_MAX_EXPONENT)
+			return(HUGE_VALL);
+	}
+
+	return(std::ldexp((f64)mantissa, exponent - F64_MANTISSA_BITS));
+}
+
+internal bool32
+scan_float(UTF8_String text, Float_Literal *literal, Decimal *decimal)
 {
-	assert(text[0] != '-');
-	u64 decimal_offset = 0;
-	bool32 has_decimal = false;
-	for (; decimal_offset < text.length; ++decimal_offset)
+	// digits with '_' separators, a decimal point and an exponent;
+	// every digit also goes into 'decimal', when there is one
+	// 19 digits at a time fit a u64
+	u64 leading  = 0;
+	u64 trailing = 0;
+	u64 trailing_scale = 1;
+	u32 kept  = 0;
+	s64 power = 0;
+	literal->truncated = false;
+	if (decimal)
 	{
-		if (text[decimal_offset] == '.')
+		decimal->count     = 0;
+		decimal->point     = 0;
+		decimal->truncated = false;
+	}
+
+	bool32 has_digits = false;
+	bool32 has_point  = false;
+	u64 i = 0;
+	for (; i < text.length; ++i)
+	{
+		u32 codepoint = text[i];
+		if (codepoint >= '0' && codepoint <= '9')
 		{
-			has_decimal = true;
-			break;
+			u8 digit = (u8)(codepoint - '0');
+			has_digits = true;
+			if (!kept && !digit)
+			{
+				// leading zeros only move the point
+				if (has_point)
+				{
+					--power;
+					if (decimal)
+						--decimal->point;
+				}
+				continue;
+			}
+			if (kept < 38)
+			{
+				if (kept < 19)
+					leading = 10 * leading + digit;
+				else
+				{
+					trailing = 10 * trailing + digit;
+					trailing_scale *= 10;
+				}
+				++kept;
+				power -= has_point;
+			}
+			else
+			{
+				power += !has_point;
+				if (digit)
+					literal->truncated = true;
+			}
+
+			if (decimal)
+			{
+				if (!has_point)
+					++decimal->point;
+				if (decimal->count < DECIMAL_DIGITS)
+					decimal->digits[decimal->count++] = digit;
+				else if (digit)
+					decimal->truncated = true;
+			}
 		}
+		else if (codepoint == '.' && !has_point)
+			has_point = true;
+		else if (codepoint != '_')
+			break;
 	}
+	if (!has_digits)
+		return(false);
 
-	f64 result = (f64)parse_integer(substring(text, 0, decimal_offset));
-
-	if (has_decimal)
+	if (i < text.length && (text[i] == 'e' || text[i] == 'E'))
 	{
-		f64 pow_ten = 1;
-		for (u64 i = decimal_offset + 1; i < text.length; ++i)
+		++i;
+		bool32 negative = false;
+		if (i < text.length && (text[i] == '+' || text[i] == '-'))
+			negative = text[i++] == '-';
+
+		bool32 has_exponent_digits = false;
+		s64 exponent = 0;
+		for (; i < text.length; ++i)
 		{
 			if (text[i] >= '0' && text[i] <= '9')
-				pow_ten *= 10;
+			{
+				has_exponent_digits = true;
+				if (exponent < 100000000)
+					exponent = 10 * exponent + (text[i] - '0');
+			}
 			else if (text[i] != '_')
-				throw("Parse failure: invalid literal");
+				break;
 		}
-		result += parse_integer(substring(text, decimal_offset + 1)) / pow_ten;
+		if (!has_exponent_digits)
+			return(false);
+		power += negative? -exponent : exponent;
+		if (decimal)
+			decimal->point = (s32)clamp(decimal->point + (negative? -exponent : exponent), -200000000, 200000000);
 	}
+	if (i < text.length)
+		return(false);
+
+	literal->digits = add_u128(multiply_u64(leading, trailing_scale), trailing);
+	literal->power  = (s32)clamp(power, -200000000, 200000000);
+	if (decimal)
+		trim_decimal(decimal);
+	return(true);
+}
 
-	return(result);
+internal f64
+round_digits_to_f64(U128 digits, s32 power, bool32 truncated)
+{
+	// digits * 10^power to the nearest, ties to even, or a little above it if 'truncated'
+	if ((!digits.high && !digits.low) || power < POWER_OF_TEN_MIN)
+		return(0);
+	if (power > POWER_OF_TEN_MAX)
+		return(HUGE_VALL);
+
+	// scaled to 2 or 3 bits past the mantissa, a round bit and at least one below it
+	s32 estimate = count_bits(digits) - 1 + floor_log2_power_of_ten(power);
+	s32 power_of_two = LDBL_MANT_DIG + 1 - estimate;
+	Scaled scaled = multiply_by_powers(digits, power_of_two, get_power_of_ten(power));
+
+	// the bits past the mantissa, more of them below the smallest normal exponent
+	s32 bits = count_bits(scaled.integer);
+	s32 exponent = bits - 1 - power_of_two;
+	s32 dropped = bits - LDBL_MANT_DIG;
+	if (exponent < F64_MIN_EXPONENT)
+		dropped += F64_MIN_EXPONENT - exponent;
+	if (dropped > bits)
+		return(0);
+
+	U128 half = shift_right_u128(scaled.integer, dropped - 1);
+	U128 mantissa = shift_right_u128(half, 1);
+	bool32 is_past_half = !scaled.exact || truncated ||
+		!equal_u128(shift_left_u128(half, dropped - 1), scaled.integer);
+	if ((half.low & 1) && (is_past_half || (mantissa.low & 1)))
+	{
+		mantissa = add_u128(mantissa, 1);
+		// carried into a new bit (past 64 with a 64-bit mantissa)
+		if (mantissa.high)
+		{
+			mantissa = shift_right_u128(mantissa, 1);
+			++dropped;
+		}
+	}
+	return(std::ldexp((f64)mantissa.low, dropped - power_of_two));
+}
+
+internal bool32
+parse_short_float(UTF8_String text, f64 *value)
+{
+	// the usual literal, a few digits and maybe a point, fits a u64 and an exact division,
+	// so it never needs more. Anything else is left to parse_long_float.
+	u64 mantissa = 0;
+	u32 digits = 0;
+	s32 power = 0;
+	bool32 has_digits = false;
+	bool32 has_point  = false;
+	for (u64 i = 0; i < text.length; ++i)
+	{
+		u32 codepoint = text.data[i];
+		if (codepoint >= '0' && codepoint <= '9')
+		{
+			has_digits = true;
+			if (mantissa || codepoint != '0')
+			{
+				if (++digits > 19)
+					return(false);
+				mantissa = 10 * mantissa + (codepoint - '0');
+			}
+			if (has_point)
+				--power;
+		}
+		else if (codepoint == '.' && !has_point)
+			has_point = true;
+		else if (codepoint != '_')
+			return(false);
+	}
+	if (!has_digits || power < -F64_MAX_EXACT_POWER_OF_TEN || mantissa > F64_MAX_EXACT_INTEGER)
+		return(false);
+	*value = power? (f64)mantissa / exact_powers_of_ten[-power] : (f64)mantissa;
+	return(true);
+}
+
+internal bool32
+parse_long_float(UTF8_String text, f64 *value)
+{
+	Float_Literal literal;
+	if (!scan_float(text, &literal, 0))
+		return(false);
+
+	// exact digits scaled by an exact power of ten round only once
+	if (!literal.truncated && !literal.digits.high && literal.digits.low <= F64_MAX_EXACT_INTEGER &&
+		literal.power >= -F64_MAX_EXACT_POWER_OF_TEN && literal.power <= F64_MAX_EXACT_POWER_OF_TEN)
+	{
+		f64 digits = (f64)literal.digits.low;
+		*value = literal.power < 0? digits / exact_powers_of_ten[-literal.power] : digits * exact_powers_of_ten[literal.power];
+		return(true);
+	}
+
+	// the 128-bit product; past 38 digits the literal is somewhere between digits and digits + 1,
+	// and only if those two round apart do the rest of its digits matter
+	*value = round_digits_to_f64(literal.digits, literal.power, literal.truncated);
+	if (literal.truncated && *value != round_digits_to_f64(add_u128(literal.digits, 1), literal.power, false))
+	{
+		Decimal decimal;
+		scan_float(text, &literal, &decimal);
+		*value = convert_decimal_to_f64(&decimal);
+	}
+	return(true);
+}
+
+bool32
+parse_float(UTF8_String text, f64 *value)
+{
+	// digits with '_' separators, a decimal point and an exponent, correctly rounded
+	return(parse_short_float(text, value) || parse_long_float(text, value));
 }
\ No newline at end of file
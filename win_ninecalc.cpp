@@ -1,5 +1,5 @@
 #include "ninecalc.cpp"
-#include "stb_truetype.h"
+#include "truetype_font.h"
 
 #include <windows.h>
 #include <stdio.h>
@@ -62,6 +62,7 @@ win_resize_backbuffer(WIN_Graphics *graphics, u32 width, u32 height)
 
 	u32 size = width * height * graphics->bytes_per_pixel;
 	graphics->canvas.buffer = (u32*)VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	graphics->canvas.contents_lost = true;
 }
 
 internal void
@@ -101,6 +102,27 @@ win_update_button(Input_Button *button, bool is_down, bool32 repeat_key = false)
 	}
 }
 
+#if PROFILE
+internal void
+win_write_profile_trace(char *file_path)
+{
+	// the last frames, for chrome://tracing
+	Memory_Arena memory = win_allocate_memory(mebibytes(16));
+	if (memory.data)
+	{
+		UTF8_String trace = format_profile_trace(&memory, PROFILE_FRAME_COUNT);
+		HANDLE file = CreateFile(file_path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			u32 bytes_written;
+			WriteFile(file, trace.data, (u32)trace.length, (LPDWORD)&bytes_written, 0);
+			CloseHandle(file);
+		}
+		win_free_memory(&memory);
+	}
+}
+#endif
+
 internal LRESULT
 win_callback (HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 {
@@ -128,13 +150,14 @@ win_callback (HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 			u32 height = client_rect.bottom - client_rect.top;
 			win_resize_backbuffer(&win_graphics, width, height);
 		} break;
-		/*case WM_PAINT:
+		case WM_PAINT:
 		{
+			// the whole canvas, clipped to what was invalidated
 			PAINTSTRUCT paint;
 			HDC device_context = BeginPaint(window, &paint);
 			win_update_window(window, device_context, &win_graphics);
 			EndPaint(window, &paint);
-		} break;*/
+		} break;
 		case WM_KEYDOWN:
 		case WM_KEYUP:
 		{
@@ -160,6 +183,10 @@ win_callback (HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 			else if (wparam == 'C') win_update_button(&keyboard.copy , key_is_down && control_key_is_down);
 			else if (wparam == 'V') win_update_button(&keyboard.paste, key_is_down && control_key_is_down);
 			else if (wparam == 'S') win_update_button(&keyboard.save , key_is_down && control_key_is_down);
+#if PROFILE
+			else if (wparam == VK_F9 && key_is_down && !key_was_down)
+				win_write_profile_trace("profile_trace.json");
+#endif
 		} break;
 		case WM_UNICHAR:
 		case WM_CHAR:
@@ -167,7 +194,7 @@ win_callback (HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 			if (wparam == UNICODE_NOCHAR)
 				result = true;
 			u32 character = (u32)wparam;
-			if (codepoint_is_in_range(state->font, character))
+			if (codepoint_is_printable(character))
 				insert_character_if_fits(&keyboard.input_buffer, character, keyboard.input_buffer.length);
 		} break;
 		case WM_MOUSEMOVE:
@@ -201,7 +228,7 @@ win_callback (HWND window, UINT message, WPARAM wparam, LPARAM lparam)
 }
 
 internal u8 *
-win_read_file(char *file_path)
+win_read_file(char *file_path, u64 *size = 0)
 {
 	void *buffer = 0;
 
@@ -219,6 +246,10 @@ win_read_file(char *file_path)
 	{
 		buffer = 0;
 	}
+	else if (size)
+	{
+		*size = file_size;
+	}
 
 	CloseHandle(file);
 
@@ -231,80 +262,80 @@ win_free_file(u8 *buffer)
 	VirtualFree((void *)buffer, 0, MEM_RELEASE);
 }
 
-Font 
-win_load_font(Memory_Arena *memory, char *ttf_filepath, u32 line_height)
+internal u8 *
+win_map_file(char *file_path, u64 *size)
 {
-	Font loaded_font = {};
-	// init line_height
-	loaded_font.line_height = line_height;
-
-	u8* font_data = win_read_file(ttf_filepath);
-
-	stbtt_fontinfo font;
-	stbtt_InitFont(&font, font_data, 0);
-
-	f32 scale = stbtt_ScaleForPixelHeight(&font, (f32)line_height);
-
-	{ // init baseline
-		s32 temp_basline;
-		stbtt_GetFontVMetrics(&font, &temp_basline, 0, 0);
-		loaded_font.baseline = (u32)((f32)temp_basline * scale);
-	}
-
-	{ // init ranges
-		u32 ranges[][2] = { {32, 126} };
-		loaded_font.range_count = array_count(ranges);
-		loaded_font.ranges = (u32 (*)[2])allocate_bytes(memory, sizeof(ranges));
-		for (u32 i = 0; i < sizeof(ranges) / 4; i++)
-		{
-			*((u32*)loaded_font.ranges + i) = ranges[0][i];
-		}
-	}
-
-	{ // init glyphs
-		u32 n_glyphs = 0;
-		for (u32 i = 0; i < loaded_font.range_count; i++)
+	u8 *view = 0;
+	HANDLE file = CreateFile(file_path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		u32 file_size = GetFileSize(file, 0);
+		HANDLE mapping = file_size && file_size != INVALID_FILE_SIZE?
+			CreateFileMapping(file, 0, PAGE_READONLY, 0, 0, 0) : 0;
+		if (mapping)
 		{
-			u32 *range = loaded_font.ranges[i];
-			n_glyphs += range[1] - range[0] + 1;
+			// the view keeps the mapping open
+			view = (u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view)
+				*size = file_size;
+			CloseHandle(mapping);
 		}
-		loaded_font.glyphs = allocate_array(memory, Glyph, n_glyphs);
+		CloseHandle(file);
 	}
+	return(view);
+}
 
-	u32 current_glyph = 0;
-	for (u32 j = 0; j < loaded_font.range_count; j++)
-	{
-		for (u32 i = loaded_font.ranges[j][0]; i <= loaded_font.ranges[j][1]; i++)
-		{
-			Glyph* glyph = loaded_font.glyphs + (current_glyph++);
-
-			u32 glyph_index = stbtt_FindGlyphIndex(&font, i);
+internal bool32
+win_replace_file(char *file_path, UTF8_String contents)
+{
+	// written next to it first, so nothing ever maps half a file
+	char temporary_path[MAX_PATH + 8];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.new", file_path);
+	HANDLE file = CreateFile(temporary_path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return(false);
 
-			s32 x0, y0, x1, y1;
-			stbtt_GetGlyphBitmapBox(&font, glyph_index, scale, scale, &x0, &y0, &x1, &y1);
-			glyph->x = -x0;
-			glyph->y = -y0;
-			glyph->width = x1 - x0;
-			glyph->height = y1 - y0;
+	u32 bytes_written;
+	bool32 succeeded = WriteFile(file, contents.data, (u32)contents.length, (LPDWORD)&bytes_written, 0) &&
+		bytes_written == contents.length;
+	CloseHandle(file);
+	if (succeeded && !MoveFileEx(temporary_path, file_path, MOVEFILE_REPLACE_EXISTING))
+		succeeded = false;
+	if (!succeeded)
+		DeleteFile(temporary_path);
+	return(succeeded);
+}
 
-			{ // init glyph.advance
-				s32 advance, lsb;
-				stbtt_GetGlyphHMetrics(&font, glyph_index, &advance, &lsb);
-				glyph->advance = (u32)((f32)advance * scale);
-			}
+Font 
+win_load_font(Memory_Arena *memory, char *ttf_filepath, u32 line_height)
+{
+	u64 size = 0;
+	u8* font_data = win_read_file(ttf_filepath, &size);
+	// kept, glyphs are rasterized from it as they are needed
+	Font loaded_font = load_font_from_ttf(memory, font_data, line_height);
+
+	// the common glyphs come from a cache file, made the first time
+	u64 font_hash = hash_font_file(font_data, size);
+	char cache_path[MAX_PATH];
+	snprintf(cache_path, sizeof(cache_path), "%s.%u.glyphs", ttf_filepath, line_height);
+
+	u64 cache_size = 0;
+	u8 *cache = win_map_file(cache_path, &cache_size);
+	if (!cache || !attach_font_cache(&loaded_font, cache, cache_size, font_hash))
+	{
+		// unmapped first, or it couldn't be replaced
+		if (cache)
+			UnmapViewOfFile(cache);
 
-			glyph->buffer = (u8*)allocate_bytes(memory, glyph->width * glyph->height);
+		u64 used = memory->used;
+		bool32 written = win_replace_file(cache_path, make_font_cache(memory, &loaded_font, font_hash));
+		memory->used = used;
 
-			stbtt_MakeGlyphBitmap(&font, glyph->buffer,
-				glyph->width, glyph->height,
-				/*stride:*/glyph->width,
-				scale, scale,
-				glyph_index);
-		}
+		cache = written? win_map_file(cache_path, &cache_size) : 0;
+		if (cache && !attach_font_cache(&loaded_font, cache, cache_size, font_hash))
+			UnmapViewOfFile(cache);
 	}
 
-	win_free_file(font_data);
-
 	return(loaded_font);
 }
 
@@ -496,7 +527,15 @@ WinMain (HINSTANCE instance, HINSTANCE _, LPSTR command_line, int __)
 				}
 				timestamp = current_tick();
 
-				win_update_window(window, &win_graphics);
+				// only what the frame changed is presented
+				Canvas *canvas = &win_graphics.canvas;
+				for (u32 i = 0; i < canvas->dirty_rect_count; ++i)
+				{
+					Rect dirty = canvas->dirty_rects[i];
+					RECT dirty_rect = { dirty.min_x, dirty.min_y, dirty.max_x, dirty.max_y };
+					InvalidateRect(window, &dirty_rect, FALSE);
+				}
+				UpdateWindow(window);
 			}
 		}
 	}